@@ -0,0 +1,17 @@
+QT += core gui declarative
+
+# Compile to C++98:
+CONFIG += c++98 console
+QMAKE_CXXFLAGS += -std=c++98
+
+TARGET = pdf-viewer-benchmark
+TEMPLATE = app
+
+DESTDIR = build/bin
+OBJECTS_DIR = build/objects
+MOC_DIR = build/moc
+
+include(../src/pdf_viewer/pdf_viewer.pri)
+
+SOURCES += \
+    main.cpp
@@ -0,0 +1,326 @@
+#include <QApplication>
+#include <QGraphicsScene>
+#include <QImage>
+#include <QPainter>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QDir>
+#include <QFile>
+#include <QTextStream>
+#include <QStringList>
+#include <QVector>
+#include <QtAlgorithms>
+
+#include "pdf_viewer/PdfViewer.h"
+
+using pdf_viewer::PdfViewer;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////////////////////        Measurement helpers
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Latencies in milliseconds of all operations of one kind, e.g. all zoom steps:
+struct Series
+{
+    QString name;
+    QVector<qreal> latencies;
+};
+
+// Paints the scene into the offscreen target until the viewer has rendered everything visible.
+// Returns the elapsed time in milliseconds.
+qreal
+renderUntilIdle(
+        QGraphicsScene &scene,
+        PdfViewer &viewer,
+        QImage &target,
+        QElapsedTimer const &operationStart
+)
+{
+    forever
+    {
+        QPainter painter(&target);
+        scene.render(&painter);
+        painter.end();
+
+        if(!viewer.busy())
+        {
+            break;
+        }
+
+        // Wait for rendered tiles or the zoom settle timer:
+        QApplication::processEvents(QEventLoop::WaitForMoreEvents);
+    }
+
+    return operationStart.nsecsElapsed() / 1000000.0;
+}
+
+// Runs a single operation, which has already been triggered, to completion and records its latency.
+void
+measure(
+        Series &series,
+        QGraphicsScene &scene,
+        PdfViewer &viewer,
+        QImage &target,
+        QElapsedTimer const &operationStart
+)
+{
+    series.latencies.append(renderUntilIdle(scene, viewer, target, operationStart));
+}
+
+qreal
+percentile(
+        QVector<qreal> sortedValues,
+        qreal const p
+)
+{
+    if(sortedValues.isEmpty())
+    {
+        return 0;
+    }
+    int const index = qBound(0, qRound(p * (sortedValues.size() - 1)), sortedValues.size() - 1);
+    return sortedValues.at(index);
+}
+
+// Peak resident set size in kilobytes, or -1 if the platform does not report it.
+qint64
+peakMemoryKb()
+{
+    QFile status("/proc/self/status");
+    if(!status.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        return -1;
+    }
+
+    QStringList const lines = QString::fromLatin1(status.readAll().constData()).split('\n');
+    for(int i = 0; i < lines.size(); i++)
+    {
+        if(lines.at(i).startsWith("VmHWM:"))
+        {
+            return lines.at(i).mid(6).simplified().split(' ').first().toInt();
+        }
+    }
+    return -1;
+}
+
+QString
+jsonString(
+        QString value
+)
+{
+    value.replace("\\", "\\\\");
+    value.replace("\"", "\\\"");
+    return "\"" + value + "\"";
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////////////////////        Benchmark
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Drives the PdfViewer render path headlessly over a set of PDF files and prints the results
+ * as JSON to the standard output.
+ *
+ * Usage: pdf-viewer-benchmark [directory or PDF files...] [--size WIDTHxHEIGHT] [--pages N] [--trace FILE]
+ *
+ * By default, all PDFs inside `test-pdf/` of the current working directory are benchmarked.
+ * Qt 4 still needs a display connection to create the application, use e.g. `xvfb-run` on
+ * headless machines.
+ */
+int main(int argc, char *argv[])
+{
+    QApplication a(argc, argv);
+
+    // Parse arguments:
+    QStringList files;
+    int viewportWidth = 1200;
+    int viewportHeight = 800;
+    int maxPages = 10;
+    QString traceFile;
+    QStringList const arguments = a.arguments();
+    for(int i = 1; i < arguments.size(); i++)
+    {
+        if(arguments.at(i) == "--size" && i + 1 < arguments.size())
+        {
+            QStringList const size = arguments.at(++i).split('x');
+            viewportWidth = size.first().toInt();
+            viewportHeight = size.last().toInt();
+        }
+        else if(arguments.at(i) == "--pages" && i + 1 < arguments.size())
+        {
+            maxPages = arguments.at(++i).toInt();
+        }
+        else if(arguments.at(i) == "--trace" && i + 1 < arguments.size())
+        {
+            traceFile = arguments.at(++i);
+        }
+        else if(QDir(arguments.at(i)).exists())
+        {
+            QDir const directory(arguments.at(i));
+            QStringList const pdfs = directory.entryList(QStringList() << "*.pdf", QDir::Files, QDir::Name);
+            for(int j = 0; j < pdfs.size(); j++)
+            {
+                files.append(directory.filePath(pdfs.at(j)));
+            }
+        }
+        else
+        {
+            files.append(arguments.at(i));
+        }
+    }
+    if(files.isEmpty())
+    {
+        QDir const directory("test-pdf");
+        QStringList const pdfs = directory.entryList(QStringList() << "*.pdf", QDir::Files, QDir::Name);
+        for(int j = 0; j < pdfs.size(); j++)
+        {
+            files.append(directory.filePath(pdfs.at(j)));
+        }
+    }
+
+    // The viewer is painted through a scene into an offscreen image, just like the declarative view would do:
+    QGraphicsScene scene;
+    PdfViewer viewer;
+    scene.addItem(&viewer);
+    viewer.setWidth(viewportWidth);
+    viewer.setHeight(viewportHeight);
+    viewer.setBackgroundColor(QColor("#eee"));
+    viewer.setRenderTextAntiAliased(true);
+    viewer.setRenderImageAntiAliased(true);
+    viewer.setPrefetchRadius(0);            // Only measure what is visible
+    viewer.setZoomSettleInterval(0);        // Do not measure the debounce delay
+    viewer.setInteractionQuality(PdfViewer::FULL_QUALITY); // Measure final quality, not the fast interaction tier
+    viewer.setTraceFile(traceFile);
+    QImage target(viewportWidth, viewportHeight, QImage::Format_ARGB32_Premultiplied);
+
+    QTextStream out(stdout);
+    out << "{\n";
+    out << "  \"viewport\": [" << viewportWidth << ", " << viewportHeight << "],\n";
+    out << "  \"documents\": [\n";
+
+    qreal const zoomLevels[] = { 1.0, 1.5, 2.0, 3.0, 4.0, 6.0 };
+    int const zoomLevelCount = sizeof(zoomLevels) / sizeof(zoomLevels[0]);
+
+    for(int f = 0; f < files.size(); f++)
+    {
+        QVector<Series> results(5);
+        Series &open = results[0];
+        Series &pages = results[1];
+        Series &zooms = results[2];
+        Series &orientations = results[3];
+        Series &pans = results[4];
+        open.name = "open";
+        pages.name = "page";
+        zooms.name = "zoom";
+        orientations.name = "orientation";
+        pans.name = "pan";
+
+        QElapsedTimer timer;
+
+        // Open the document, which renders the first page:
+        viewer.stats()->reset();
+        timer.start();
+        viewer.setSource(files.at(f));
+        measure(open, scene, viewer, target, timer);
+        if(PdfViewer::OK != viewer.status())
+        {
+            out << "    { \"file\": " << jsonString(files.at(f)) << ", \"error\": " << jsonString(viewer.statusMessage()) << " }"
+                << (f + 1 < files.size() ? "," : "") << "\n";
+            continue;
+        }
+
+        // Switch through the pages at fit zoom:
+        QElapsedTimer pagesTimer;
+        pagesTimer.start();
+        int pageCount = 0;
+        for(int page = 1; page < maxPages; page++)
+        {
+            int const previous = viewer.pageNumber();
+            timer.start();
+            viewer.setPageNumber(page);
+            if(viewer.pageNumber() == previous)
+            {
+                break;
+            }
+            measure(pages, scene, viewer, target, timer);
+            pageCount++;
+        }
+        qreal const pagesPerSecond = pageCount > 0 ? pageCount * 1000.0 / qMax(Q_INT64_C(1), pagesTimer.elapsed()) : 0;
+        viewer.setPageNumber(0);
+        renderUntilIdle(scene, viewer, target, timer);
+
+        // Every orientation at every zoom level:
+        for(int o = PdfViewer::ZERO_PI; o <= PdfViewer::ONE_HALF_PI; o++)
+        {
+            timer.start();
+            viewer.setPageOrientation(static_cast<PdfViewer::PageOrientation>(o));
+            measure(orientations, scene, viewer, target, timer);
+
+            for(int z = 0; z < zoomLevelCount; z++)
+            {
+                timer.start();
+                viewer.setZoom(zoomLevels[z]);
+                measure(zooms, scene, viewer, target, timer);
+            }
+        }
+        viewer.setPageOrientation(PdfViewer::ZERO_PI);
+
+        // Pan around at a high zoom, in steps like a mouse drag would produce:
+        viewer.setZoom(4);
+        renderUntilIdle(scene, viewer, target, timer);
+        qreal const bytesBeforePans = viewer.stats()->bytesCopied();
+        int const panCountBeforePans = viewer.stats()->panCount();
+        QPoint const steps[] = { QPoint(-40, 0), QPoint(0, -40), QPoint(40, 0), QPoint(0, 40) };
+        for(int direction = 0; direction < 4; direction++)
+        {
+            for(int step = 0; step < 20; step++)
+            {
+                timer.start();
+                viewer.setPan(viewer.pan() + steps[direction]);
+                measure(pans, scene, viewer, target, timer);
+            }
+        }
+        int const panCount = viewer.stats()->panCount() - panCountBeforePans;
+        qreal const bytesCopiedPerPan = panCount > 0 ? (viewer.stats()->bytesCopied() - bytesBeforePans) / panCount : 0;
+        viewer.setZoom(1);
+
+        // Report:
+        out << "    {\n";
+        out << "      \"file\": " << jsonString(files.at(f)) << ",\n";
+        out << "      \"pagesPerSecond\": " << pagesPerSecond << ",\n";
+        pdf_viewer::RenderStats const * const stats = viewer.stats();
+        out << "      \"stats\": { "
+            << "\"renderCount\": " << stats->renderCount() << ", "
+            << "\"pixelsRasterized\": " << stats->pixelsRasterized() << ", "
+            << "\"renderTime\": " << stats->renderTime() << ", "
+            << "\"paintCount\": " << stats->paintCount() << ", "
+            << "\"paintTime\": " << stats->paintTime() << ", "
+            << "\"cacheHits\": " << stats->cacheHits() << ", "
+            << "\"cacheMisses\": " << stats->cacheMisses() << ", "
+            << "\"cancelledJobs\": " << stats->cancelledJobs() << ", "
+            << "\"missedDeadlines\": " << stats->missedDeadlines() << ", "
+            << "\"bytesCopied\": " << stats->bytesCopied() << ", "
+            << "\"bytesCopiedPerPan\": " << bytesCopiedPerPan << " },\n";
+        out << "      \"operations\": {\n";
+        for(int s = 0; s < results.size(); s++)
+        {
+            QVector<qreal> sorted = results.at(s).latencies;
+            qSort(sorted.begin(), sorted.end());
+            out << "        " << jsonString(results.at(s).name) << ": { "
+                << "\"count\": " << sorted.size() << ", "
+                << "\"p50\": " << percentile(sorted, 0.5) << ", "
+                << "\"p90\": " << percentile(sorted, 0.9) << ", "
+                << "\"p99\": " << percentile(sorted, 0.99) << ", "
+                << "\"max\": " << (sorted.isEmpty() ? 0 : sorted.last()) << " }"
+                << (s + 1 < results.size() ? "," : "") << "\n";
+        }
+        out << "      }\n";
+        out << "    }" << (f + 1 < files.size() ? "," : "") << "\n";
+    }
+
+    out << "  ],\n";
+    out << "  \"latencyUnit\": \"ms\",\n";
+    out << "  \"peakMemoryKb\": " << peakMemoryKb() << "\n";
+    out << "}\n";
+
+    return 0;
+}
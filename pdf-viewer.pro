@@ -6,7 +6,6 @@ QMAKE_CXXFLAGS += -std=c++98
 
 TARGET = pdf-viewer
 TEMPLATE = app
-LIBS += -lpoppler-qt4
 
 DESTDIR = build/bin
 OBJECTS_DIR = build/objects
@@ -15,13 +14,7 @@ RCC_DIR = build/rcc
 
 RESOURCES += rc.qrc
 
-SOURCES += \
-    src/main.cpp \
-    src/pdf_viewer/PdfViewer.cpp \
-    src/pdf_viewer/PdfDocument.cpp \
-    src/pdf_viewer/Polynomial.cpp
+include(src/pdf_viewer/pdf_viewer.pri)
 
-HEADERS  += \
-    src/pdf_viewer/PdfViewer.h \
-    src/pdf_viewer/PdfDocument.h \
-    src/pdf_viewer/Polynomial.h
+SOURCES += \
+    src/main.cpp
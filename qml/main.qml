@@ -6,6 +6,22 @@ Item {
     height: 600
     property color themeColor: "#1fd174"
 
+    // Hits of the current search, refreshed while the text is still being indexed:
+    property variant searchHits: []
+    property int searchHitIndex: -1
+
+    function search() {
+        searchHits = searchInput.text.length > 0 ? pdf.search(searchInput.text) : []
+        searchHitIndex = -1
+    }
+
+    function showNextSearchHit() {
+        if(searchHits.length > 0) {
+            searchHitIndex = (searchHitIndex + 1) % searchHits.length
+            pdf.pageNumber = searchHits[searchHitIndex].pageNumber
+        }
+    }
+
     // PDF Viewer:
     PdfViewer {
         id: pdf
@@ -16,6 +32,8 @@ Item {
         backgroundColor: "#eee"
         renderImageAntiAliased: true
         renderTextAntiAliased: true
+        interactionQuality: PdfViewer.NOT_ANTI_ALIASED
+        diskCacheDirectory: cacheDirectory
         source: pathProvider.getPath(0)
 
         onZoomChanged: zoomSlider.value = (zoom - pdf.fitZoom) / (maxZoom - 1)
@@ -80,6 +98,99 @@ Item {
             }
     }
 
+    Connections {
+        target: pdf
+        onTextIndexProgressChanged: search()
+    }
+
+    // Highlights of the search hits, following pan, zoom and orientation:
+    Item {
+        anchors.fill: pdf
+        clip: true
+
+        Repeater {
+            model: searchHits
+
+            Repeater {
+                property variant hit: modelData
+                model: hit.rects
+
+                Rectangle {
+                    property rect box: (pdf.pan, pdf.zoom, pdf.pageOrientation, pdf.width, pdf.height,
+                                        pdf.mapFromPage(hit.pageNumber, modelData))
+                    x: box.x
+                    y: box.y
+                    width: box.width
+                    height: box.height
+                    color: themeColor
+                    opacity: index == searchHitIndex ? 0.6 : 0.3
+                    visible: pdf.continuous || hit.pageNumber == pdf.pageNumber
+                }
+            }
+        }
+    }
+
+    // Thumbnails of all pages, rendered in the background:
+    PdfThumbnails {
+        id: pageThumbnails
+        source: pdf.source
+        currentPage: pdf.pageNumber
+        thumbnailSize: 128
+    }
+
+    // Page overview, showing a grid of thumbnails:
+    Rectangle {
+        id: overview
+        anchors.top: parent.top
+        anchors.bottom: buttons.top
+        anchors.right: parent.right
+        anchors.left: parent.left
+        color: "#eee"
+        visible: false
+
+        GridView {
+            id: overviewGrid
+            anchors.fill: parent
+            anchors.margins: 10
+            cellWidth: pageThumbnails.thumbnailSize + 20
+            cellHeight: pageThumbnails.thumbnailSize + 30
+            clip: true
+            model: pageThumbnails.count
+            currentIndex: pdf.pageNumber
+
+            delegate: Item {
+                width: overviewGrid.cellWidth
+                height: overviewGrid.cellHeight
+
+                PdfThumbnail {
+                    anchors.top: parent.top
+                    anchors.horizontalCenter: parent.horizontalCenter
+                    width: pageThumbnails.thumbnailSize
+                    height: pageThumbnails.thumbnailSize
+                    thumbnails: pageThumbnails
+                    pageNumber: index
+                }
+
+                Text {
+                    anchors.bottom: parent.bottom
+                    anchors.horizontalCenter: parent.horizontalCenter
+                    anchors.bottomMargin: 5
+                    text: index + 1
+                    font.bold: index == pdf.pageNumber
+                    opacity: 0.5
+                }
+
+                MouseArea {
+                    anchors.fill: parent
+                    onClicked: {
+                        pdf.pageNumber = index
+                        overview.visible = false
+                    }
+                }
+            }
+        }
+    }
+
     // Zoom slider:
     Slider {
         id: zoomSlider
@@ -185,6 +296,18 @@ Item {
                 }
             }
 
+            // Toggle the page overview:
+            Button {
+                text: overview.visible ? "Close pages" : "Pages"
+                onClicked: overview.visible = !overview.visible
+            }
+
+            // Toggle continuous scrolling through all pages:
+            Button {
+                text: pdf.continuous ? "Single page" : "Continuous"
+                onClicked: pdf.continuous = !pdf.continuous
+            }
+
             // Rotate counter-clockwise:
             Button {
                 text: "↶"
@@ -254,6 +377,36 @@ Item {
             anchors.margins: 10
             spacing: 10
 
+            // Search field, Enter jumps to the next hit:
+            Rectangle {
+                width: 150
+                anchors.top: parent.top
+                anchors.bottom: parent.bottom
+                color: "#eee"
+
+                TextInput {
+                    id: searchInput
+                    anchors.left: parent.left
+                    anchors.right: parent.right
+                    anchors.verticalCenter: parent.verticalCenter
+                    anchors.margins: 5
+
+                    onTextChanged: search()
+                    onAccepted: showNextSearchHit()
+                }
+            }
+
+            // Search hit count, and indexing progress until the whole text is searchable:
+            Text {
+                text: searchHits.length + " hits"
+                      + (pdf.textIndexProgress < 1 ? " (" + Math.round(pdf.textIndexProgress * 100) + "% indexed)" : "")
+                anchors.top: parent.top
+                anchors.bottom: parent.bottom
+                verticalAlignment: Text.AlignVCenter
+                opacity: 0.5
+                visible: searchInput.text.length > 0
+            }
+
             // Zoom indicator:
             Text {
                 text: Math.round(pdf.zoom * 100) + "%"
@@ -2,10 +2,15 @@
 #include <QMainWindow>
 #include <QIcon>
 #include <QDeclarativeView>
+#include <QDeclarativeContext>
+#include <QDesktopServices>
 
 #include "pdf_viewer/PdfViewer.h"
 #include "pdf_viewer/PdfDocument.h"
+#include "pdf_viewer/PdfThumbnail.h"
+#include "pdf_viewer/PdfThumbnails.h"
 #include "pdf_viewer/Polynomial.h"
+#include "pdf_viewer/RenderStats.h"
 
 int main(int argc, char *argv[])
 {
@@ -14,6 +19,9 @@ int main(int argc, char *argv[])
     // Register PDF viewer component to QML:
     qmlRegisterType<pdf_viewer::PdfDocument>("PdfViewing", 1, 0, "PdfDocument");
     qmlRegisterType<pdf_viewer::PdfViewer>("PdfViewing", 1, 0, "PdfViewer");
+    qmlRegisterType<pdf_viewer::PdfThumbnails>("PdfViewing", 1, 0, "PdfThumbnails");
+    qmlRegisterType<pdf_viewer::PdfThumbnail>("PdfViewing", 1, 0, "PdfThumbnail");
+    qmlRegisterUncreatableType<pdf_viewer::RenderStats>("PdfViewing", 1, 0, "RenderStats", "RenderStats is owned by a PdfViewer, read it through its stats property");
 
     // Create the main window:
     QMainWindow window;
@@ -21,6 +29,7 @@ int main(int argc, char *argv[])
 
     // Create the declarative view, displaying the `main.qml` file:
     QDeclarativeView *view = new QDeclarativeView;
+    view->rootContext()->setContextProperty("cacheDirectory", QDesktopServices::storageLocation(QDesktopServices::CacheLocation) + "/tiles");
     view->setSource(QUrl("qrc:/qml/main.qml"));
     view->setResizeMode(QDeclarativeView::SizeRootObjectToView);
     window.setCentralWidget(view);
@@ -0,0 +1,339 @@
+#include "DiskCache.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutexLocker>
+#include <QThread>
+#include <QWeakPointer>
+
+#include <utime.h>
+
+namespace pdf_viewer {
+
+namespace {
+
+// Marks a file as cached image, so a cache file written by a different version is not misread:
+const quint32 MAGIC = 0x50445643; // "PDVC"
+const int VERSION = 1;
+
+// Files making up the cache, tiles and page sizes:
+QStringList
+cacheFiles()
+{
+    return QStringList() << "*.tile" << "*.pages";
+}
+
+// Sets the modification time of a file to now, so it tells when the file has been used last, which eviction goes by.
+// Qt 4 cannot set file times, the content is left untouched:
+void
+touch(
+        QString const &path
+)
+{
+    utime(QFile::encodeName(path).constData(), NULL);
+}
+
+// Temporary file a file is written into first, one per thread, so threads storing the same file do not mix their writes:
+QString
+partPath(
+        QString const &path
+)
+{
+    return path + QString(".%1.part").arg(static_cast<quint64>(reinterpret_cast<quintptr>(QThread::currentThread())), 0, 16);
+}
+
+// Once exceeded, the cache is cut down to this share of its budget, so eviction does not run on every store:
+const qreal EVICTION_TARGET = 0.9;
+
+// All caches opened at the moment, by directory:
+QHash<QString, QWeakPointer<DiskCache> > &
+openCaches()
+{
+    static QHash<QString, QWeakPointer<DiskCache> > caches;
+    return caches;
+}
+
+} // namespace
+
+DiskCache::DiskCache(
+        QString const &directory
+)
+    : mDirectory(directory)
+    , mBudget(0)
+    , mSize(0)
+{
+    QDir const dir(mDirectory);
+    dir.mkpath(".");
+
+    QFileInfoList const files = dir.entryInfoList(cacheFiles(), QDir::Files);
+    for(int i = 0; i < files.size(); i++)
+    {
+        mSize += files.at(i).size();
+    }
+}
+
+QSharedPointer<DiskCache>
+DiskCache::open(
+        QString const &directory,
+        qint64 const budget
+)
+{
+    QString const key = QDir(directory).absolutePath();
+
+    QSharedPointer<DiskCache> cache = openCaches().value(key).toStrongRef();
+    if(cache.isNull())
+    {
+        cache = QSharedPointer<DiskCache>(new DiskCache(key));
+        openCaches().insert(key, cache.toWeakRef());
+    }
+    cache->setBudget(budget);
+    return cache;
+}
+
+QString
+DiskCache::documentHash(
+        QString const &path
+)
+{
+    QFile file(path);
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        return QString();
+    }
+
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    while(!file.atEnd())
+    {
+        hash.addData(file.read(1024 * 1024));
+    }
+    return QString::fromLatin1(hash.result().toHex().constData());
+}
+
+void
+DiskCache::setBudget(
+        qint64 const budget
+)
+{
+    QMutexLocker locker(&mMutex);
+    mBudget = budget;
+}
+
+QString
+DiskCache::filePath(
+        QString const &documentHash,
+        TileKey const &key
+) const
+{
+    return mDirectory + "/" + QString("%1_%2_%3_%4_%5_%6_%7.tile")
+            .arg(documentHash)
+            .arg(key.pageNumber)
+            .arg(key.scale)
+            .arg(key.orientation)
+            .arg(key.renderHints)
+            .arg(key.column)
+            .arg(key.row);
+}
+
+QString
+DiskCache::pageSizesPath(
+        QString const &documentHash
+) const
+{
+    return mDirectory + "/" + documentHash + ".pages";
+}
+
+QImage
+DiskCache::load(
+        QString const &documentHash,
+        TileKey const &key
+) const
+{
+    QString const path = filePath(documentHash, key);
+    QFile file(path);
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        return QImage();
+    }
+
+    QDataStream stream(&file);
+    quint32 magic;
+    qint32 version;
+    qint32 width;
+    qint32 height;
+    qint32 format;
+    stream >> magic >> version >> width >> height >> format;
+    if(MAGIC != magic || VERSION != version || width <= 0 || height <= 0)
+    {
+        return QImage();
+    }
+
+    // The pixels follow the header as they are laid out in memory:
+    QImage image(width, height, static_cast<QImage::Format>(format));
+    if(image.isNull() || stream.readRawData(reinterpret_cast<char *>(image.bits()), image.byteCount()) != image.byteCount())
+    {
+        return QImage();
+    }
+    file.close();
+    touch(path);
+    return image;
+}
+
+void
+DiskCache::store(
+        QString const &documentHash,
+        TileKey const &key,
+        QImage const &image
+)
+{
+    if(image.isNull())
+    {
+        return;
+    }
+
+    // Write into a temporary file first, so no other thread ever loads a partially written image:
+    QString const path = filePath(documentHash, key);
+    QFile file(partPath(path));
+    if(!file.open(QIODevice::WriteOnly))
+    {
+        return;
+    }
+
+    QDataStream stream(&file);
+    stream << MAGIC << qint32(VERSION) << qint32(image.width()) << qint32(image.height()) << qint32(image.format());
+    stream.writeRawData(reinterpret_cast<char const *>(image.constBits()), image.byteCount());
+    qint64 const size = file.size();
+    file.close();
+
+    commit(path, size);
+}
+
+QVector<QSize>
+DiskCache::loadPageSizes(
+        QString const &documentHash
+) const
+{
+    QString const path = pageSizesPath(documentHash);
+    QFile file(path);
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        return QVector<QSize>();
+    }
+
+    QDataStream stream(&file);
+    quint32 magic;
+    qint32 version;
+    qint32 count;
+    stream >> magic >> version >> count;
+
+    // Each page takes two integers, a count beyond that would only be a corrupted file:
+    if(MAGIC != magic || VERSION != version || count <= 0 || count > (file.size() - file.pos()) / 8)
+    {
+        return QVector<QSize>();
+    }
+
+    QVector<QSize> pageSizes(count);
+    for(int i = 0; i < count; i++)
+    {
+        qint32 width;
+        qint32 height;
+        stream >> width >> height;
+        pageSizes[i] = QSize(width, height);
+    }
+    if(QDataStream::Ok != stream.status())
+    {
+        return QVector<QSize>();
+    }
+    file.close();
+    touch(path);
+    return pageSizes;
+}
+
+void
+DiskCache::storePageSizes(
+        QString const &documentHash,
+        QVector<QSize> const &pageSizes
+)
+{
+    if(pageSizes.isEmpty())
+    {
+        return;
+    }
+
+    QString const path = pageSizesPath(documentHash);
+    QFile file(partPath(path));
+    if(!file.open(QIODevice::WriteOnly))
+    {
+        return;
+    }
+
+    QDataStream stream(&file);
+    stream << MAGIC << qint32(VERSION) << qint32(pageSizes.size());
+    for(int i = 0; i < pageSizes.size(); i++)
+    {
+        stream << qint32(pageSizes.at(i).width()) << qint32(pageSizes.at(i).height());
+    }
+    qint64 const size = file.size();
+    file.close();
+
+    commit(path, size);
+}
+
+void
+DiskCache::commit(
+        QString const &path,
+        qint64 const size
+)
+{
+    // A file stored again replaces the previous one, whose size no longer counts. Replacing is serialized
+    // with eviction and other stores, so the previous file is still the one counted in the size:
+    QMutexLocker locker(&mMutex);
+    QFileInfo const previous(path);
+    if(previous.exists())
+    {
+        qint64 const previousSize = previous.size();
+        if(QFile::remove(path))
+        {
+            mSize -= previousSize;
+        }
+    }
+
+    if(!QFile::rename(partPath(path), path))
+    {
+        QFile::remove(partPath(path));
+        return;
+    }
+
+    mSize += size;
+    if(mSize > mBudget)
+    {
+        evict();
+    }
+}
+
+void
+DiskCache::evict()
+{
+    // Files used least recently first, the directory listing is sorted by modification time, newest first:
+    QFileInfoList const files = QDir(mDirectory).entryInfoList(cacheFiles(), QDir::Files, QDir::Time);
+
+    mSize = 0;
+    for(int i = 0; i < files.size(); i++)
+    {
+        mSize += files.at(i).size();
+    }
+
+    qint64 const target = static_cast<qint64>(mBudget * EVICTION_TARGET);
+    for(int i = files.size() - 1; i >= 0 && mSize > target; i--)
+    {
+        if(QFile::remove(files.at(i).filePath()))
+        {
+            mSize -= files.at(i).size();
+        }
+    }
+}
+
+} // namespace pdf_viewer
@@ -0,0 +1,88 @@
+#ifndef DISKCACHE_H
+#define DISKCACHE_H
+
+#include <QImage>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QSize>
+#include <QString>
+#include <QVector>
+
+#include "TileCache.h"
+
+namespace pdf_viewer {
+
+/*!
+ * \class DiskCache
+ * \brief Persistent cache of rendered tiles and thumbnails within a directory, bounded by a size in bytes.
+ *
+ * Images are stored uncompressed, so loading one is far cheaper than rasterizing it again. They are
+ * identified by a hash of the document's content together with their tile key, so a reopened file
+ * is recognized even if it has been moved, while a modified one is not. Along with the images, the page
+ * geometry of each document is kept, so cached pages can be shown before the document has been parsed again.
+ * Once the budget is exceeded, the images used least recently are evicted first. Loading and storing is thread-safe, so it is done by the
+ * render workers, off the GUI thread.
+ */
+class DiskCache
+{
+
+public:
+
+    /*!
+     * \brief Hands out the cache of a directory, which is shared by everyone using the same directory.
+     * Must only be called from within the GUI thread.
+     * \param directory Cache directory, which is created if it does not exist yet.
+     * \param budget Maximum amount of bytes occupied by the cached images, the budget set last applies.
+     */
+    static QSharedPointer<DiskCache> open(QString const &directory, qint64 const budget);
+
+    /*!
+     * \brief Hashes a document's content, as it is identified by within the cache.
+     * \return The hash, or an empty string if the file cannot be read.
+     */
+    static QString documentHash(QString const &path);
+
+    void setBudget(qint64 const budget);
+
+    /*!
+     * \brief Loads a cached image.
+     * \return The image, or a null image if it has not been cached.
+     */
+    QImage load(QString const &documentHash, TileKey const &key) const;
+
+    /*!
+     * \brief Stores an image, evicting the images used least recently if the budget is exceeded.
+     */
+    void store(QString const &documentHash, TileKey const &key, QImage const &image);
+
+    /*!
+     * \brief Loads the cached page sizes of a document.
+     * \return The size of each page, or an empty vector if they have not been cached.
+     */
+    QVector<QSize> loadPageSizes(QString const &documentHash) const;
+
+    /*!
+     * \brief Stores the page sizes of a document, which are evicted along with its images.
+     */
+    void storePageSizes(QString const &documentHash, QVector<QSize> const &pageSizes);
+
+private:
+
+    explicit DiskCache(QString const &directory);
+
+    QString filePath(QString const &documentHash, TileKey const &key) const;
+    QString pageSizesPath(QString const &documentHash) const;
+    void commit(QString const &path, qint64 const size);
+    void evict();
+
+    QString const mDirectory;
+
+    QMutex mMutex;
+    qint64 mBudget;
+    qint64 mSize;
+
+};
+
+} // namespace pdf_viewer
+
+#endif // DISKCACHE_H
@@ -0,0 +1,56 @@
+#include "DocumentRegistry.h"
+
+#include <QDateTime>
+#include <QFileInfo>
+#include <QHash>
+#include <QWeakPointer>
+
+namespace pdf_viewer {
+
+namespace {
+
+// All documents opened at the moment, by canonical path and modification time:
+QHash<QString, QWeakPointer<SharedDocument> > &
+openDocuments()
+{
+    static QHash<QString, QWeakPointer<SharedDocument> > documents;
+    return documents;
+}
+
+} // namespace
+
+QSharedPointer<SharedDocument>
+DocumentRegistry::acquire(
+        QString const &path
+)
+{
+    QFileInfo const file(path);
+    QString const key = file.exists()
+            ? file.canonicalFilePath() + "|" + QString::number(file.lastModified().toMSecsSinceEpoch())
+            : path;
+
+    QSharedPointer<SharedDocument> document = openDocuments().value(key).toStrongRef();
+    if(document.isNull())
+    {
+        document = QSharedPointer<SharedDocument>(new SharedDocument(file.exists() ? file.canonicalFilePath() : path));
+        openDocuments().insert(key, document.toWeakRef());
+    }
+
+    // Forget documents closed meanwhile:
+    QHash<QString, QWeakPointer<SharedDocument> >::iterator entry = openDocuments().begin();
+    while(entry != openDocuments().end())
+    {
+        if(entry.value().isNull())
+        {
+            entry = openDocuments().erase(entry);
+        }
+        else
+        {
+            ++entry;
+        }
+    }
+
+    return document;
+}
+
+} // namespace pdf_viewer
@@ -0,0 +1,40 @@
+#ifndef DOCUMENTREGISTRY_H
+#define DOCUMENTREGISTRY_H
+
+#include <QSharedPointer>
+#include <QString>
+
+#include "SharedDocument.h"
+
+namespace pdf_viewer {
+
+/*!
+ * \class DocumentRegistry
+ * \brief Process wide registry of opened documents.
+ *
+ * Documents are identified by their canonical file path and modification time, so all viewers
+ * showing the same file share a single SharedDocument, while a modified file is opened anew.
+ * The registry only keeps weak references: a document is closed as soon as the last viewer
+ * releases it. The registry must only be used from within the GUI thread.
+ */
+class DocumentRegistry
+{
+
+public:
+
+    /*!
+     * \brief Hands out the shared document for a file path, opening it if nobody has done so yet.
+     * \param path Document file path.
+     * \return The shared document, whose Poppler document is Q_NULLPTR if the file cannot be opened.
+     */
+    static QSharedPointer<SharedDocument> acquire(QString const &path);
+
+private:
+
+    DocumentRegistry();
+
+};
+
+} // namespace pdf_viewer
+
+#endif // DOCUMENTREGISTRY_H
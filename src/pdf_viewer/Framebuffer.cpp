@@ -0,0 +1,276 @@
+#include "Framebuffer.h"
+#include "RenderStats.h"
+
+#include <QPainter>
+
+#include <string.h>
+
+namespace pdf_viewer {
+
+namespace {
+
+const int BYTES_PER_PIXEL = 4;
+
+// An area of the viewport crosses at most one wrap column and one wrap row:
+const int MAX_PIECES = 4;
+
+} // namespace
+
+const QImage::Format Framebuffer::FORMAT = QImage::Format_ARGB32_Premultiplied;
+
+Framebuffer::Framebuffer()
+    : mStats(Q_NULLPTR)
+{
+}
+
+void
+Framebuffer::setStats(
+        RenderStats * const stats
+)
+{
+    mStats = stats;
+}
+
+bool
+Framebuffer::isNull() const
+{
+    return mImage.isNull();
+}
+
+QSize
+Framebuffer::size() const
+{
+    return mImage.size();
+}
+
+QRect
+Framebuffer::rect() const
+{
+    return mImage.rect();
+}
+
+QImage
+Framebuffer::copy(
+        QRect const &rect
+) const
+{
+    QImage image(rect.size(), FORMAT);
+    QRect pieces[MAX_PIECES];
+    QPoint offsets[MAX_PIECES];
+    int const count = split(rect, pieces, offsets);
+    for(int i = 0; i < count; i++)
+    {
+        int const rowBytes = pieces[i].width() * BYTES_PER_PIXEL;
+        for(int y = pieces[i].top(); y <= pieces[i].bottom(); y++)
+        {
+            memcpy(image.scanLine(y - rect.y()) + (pieces[i].x() - rect.x()) * BYTES_PER_PIXEL,
+                   mImage.constScanLine(y + offsets[i].y()) + (pieces[i].x() + offsets[i].x()) * BYTES_PER_PIXEL,
+                   rowBytes);
+        }
+        countBytes(static_cast<qint64>(rowBytes) * pieces[i].height());
+    }
+    return image;
+}
+
+QImage
+Framebuffer::toImage() const
+{
+    return mOrigin.isNull() ? mImage : copy(rect());
+}
+
+void
+Framebuffer::resize(
+        QSize const &size,
+        QColor const &background
+)
+{
+    QImage image(size, FORMAT);
+    {
+        QPainter painter(&image);
+        painter.fillRect(image.rect(), background);
+    }
+
+    // The overlapping pixels are unwrapped into the new image, which starts at a zero origin:
+    QRect const overlap = image.rect() & mImage.rect();
+    QRect pieces[MAX_PIECES];
+    QPoint offsets[MAX_PIECES];
+    int const count = split(overlap, pieces, offsets);
+    for(int i = 0; i < count; i++)
+    {
+        int const rowBytes = pieces[i].width() * BYTES_PER_PIXEL;
+        for(int y = pieces[i].top(); y <= pieces[i].bottom(); y++)
+        {
+            memcpy(image.scanLine(y) + pieces[i].x() * BYTES_PER_PIXEL,
+                   mImage.constScanLine(y + offsets[i].y()) + (pieces[i].x() + offsets[i].x()) * BYTES_PER_PIXEL,
+                   rowBytes);
+        }
+        countBytes(static_cast<qint64>(rowBytes) * pieces[i].height());
+    }
+
+    mImage = image;
+    mOrigin = QPoint(0, 0);
+}
+
+void
+Framebuffer::fill(
+        QRect const &rect,
+        QColor const &color
+)
+{
+    QRect pieces[MAX_PIECES];
+    QPoint offsets[MAX_PIECES];
+    int const count = split(rect, pieces, offsets);
+    QPainter painter(&mImage);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    for(int i = 0; i < count; i++)
+    {
+        painter.fillRect(pieces[i].translated(offsets[i]), color);
+    }
+}
+
+void
+Framebuffer::scroll(
+        int const dx,
+        int const dy
+)
+{
+    if(isNull())
+    {
+        return;
+    }
+
+    // A pixel moving by (dx, dy) keeps its place in the image, if the origin moves the opposite way:
+    int const width = mImage.width();
+    int const height = mImage.height();
+    mOrigin.setX(((mOrigin.x() - dx) % width + width) % width);
+    mOrigin.setY(((mOrigin.y() - dy) % height + height) % height);
+}
+
+void
+Framebuffer::blit(
+        QPoint const &position,
+        QImage const &image,
+        QRect const &source
+)
+{
+    // Clip against both the image and the framebuffer:
+    QPoint const sourceOffset = source.topLeft() - position;
+    QRect const target = QRect(position, source.size()) & image.rect().translated(-sourceOffset);
+
+    QRect pieces[MAX_PIECES];
+    QPoint offsets[MAX_PIECES];
+    int const count = split(target, pieces, offsets);
+    bool const sameLayout = FORMAT == image.format() || QImage::Format_RGB32 == image.format();
+    for(int i = 0; i < count; i++)
+    {
+        QRect const piece = pieces[i];
+        if(sameLayout)
+        {
+            int const rowBytes = piece.width() * BYTES_PER_PIXEL;
+            for(int y = piece.top(); y <= piece.bottom(); y++)
+            {
+                memcpy(mImage.scanLine(y + offsets[i].y()) + (piece.x() + offsets[i].x()) * BYTES_PER_PIXEL,
+                       image.constScanLine(y + sourceOffset.y()) + (piece.x() + sourceOffset.x()) * BYTES_PER_PIXEL,
+                       rowBytes);
+            }
+        }
+        else
+        {
+            QPainter painter(&mImage);
+            painter.setCompositionMode(QPainter::CompositionMode_Source);
+            painter.drawImage(piece.topLeft() + offsets[i], image, piece.translated(sourceOffset));
+        }
+        countBytes(static_cast<qint64>(piece.width()) * piece.height() * BYTES_PER_PIXEL);
+    }
+}
+
+void
+Framebuffer::draw(
+        QRectF const &target,
+        QImage const &image,
+        QRectF const &source
+)
+{
+    // Each piece gets the whole image drawn shifted onto its place within the framebuffer, clipped to the piece:
+    QRect pieces[MAX_PIECES];
+    QPoint offsets[MAX_PIECES];
+    int const count = split(target.toAlignedRect(), pieces, offsets);
+    QPainter painter(&mImage);
+    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    for(int i = 0; i < count; i++)
+    {
+        painter.setClipRect(pieces[i].translated(offsets[i]));
+        painter.drawImage(target.translated(offsets[i]), image, source);
+        countBytes(static_cast<qint64>(pieces[i].width()) * pieces[i].height() * BYTES_PER_PIXEL);
+    }
+}
+
+void
+Framebuffer::paint(
+        QPainter * const painter,
+        QRect const &rect
+) const
+{
+    QRect pieces[MAX_PIECES];
+    QPoint offsets[MAX_PIECES];
+    int const count = split(rect, pieces, offsets);
+    for(int i = 0; i < count; i++)
+    {
+        painter->drawImage(pieces[i].topLeft(), mImage, pieces[i].translated(offsets[i]));
+        countBytes(static_cast<qint64>(pieces[i].width()) * pieces[i].height() * BYTES_PER_PIXEL);
+    }
+}
+
+int
+Framebuffer::split(
+        QRect const &rect,
+        QRect * const pieces,
+        QPoint * const offsets
+) const
+{
+    QRect const area = rect & this->rect();
+    if(area.isEmpty())
+    {
+        return 0;
+    }
+
+    // Viewport columns left of the wrap column are stored at x + ox, the others wrapped around at x + ox - width.
+    // Rows are split alike, which results in up to four pieces:
+    int const wrapX = mImage.width() - mOrigin.x();
+    int const wrapY = mImage.height() - mOrigin.y();
+    int const lefts[] = { area.left(), qMax(area.left(), wrapX) };
+    int const rights[] = { qMin(area.right(), wrapX - 1), area.right() };
+    int const tops[] = { area.top(), qMax(area.top(), wrapY) };
+    int const bottoms[] = { qMin(area.bottom(), wrapY - 1), area.bottom() };
+    int const columnOffsets[] = { mOrigin.x(), mOrigin.x() - mImage.width() };
+    int const rowOffsets[] = { mOrigin.y(), mOrigin.y() - mImage.height() };
+
+    int count = 0;
+    for(int column = 0; column < 2; column++)
+    {
+        for(int row = 0; row < 2; row++)
+        {
+            QRect const piece(QPoint(lefts[column], tops[row]), QPoint(rights[column], bottoms[row]));
+            if(!piece.isEmpty())
+            {
+                pieces[count] = piece;
+                offsets[count] = QPoint(columnOffsets[column], rowOffsets[row]);
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+void
+Framebuffer::countBytes(
+        qint64 const bytes
+) const
+{
+    if(mStats && bytes > 0)
+    {
+        mStats->addBytesCopied(bytes);
+    }
+}
+
+} // namespace pdf_viewer
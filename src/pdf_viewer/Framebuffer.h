@@ -0,0 +1,114 @@
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include <QColor>
+#include <QImage>
+#include <QRect>
+
+class QPainter;
+
+#ifndef Q_NULLPTR
+#define Q_NULLPTR NULL
+#endif // Q_NULLPTR
+
+namespace pdf_viewer {
+
+class RenderStats;
+
+/*!
+ * \class Framebuffer
+ * \brief Viewport-sized backing store the rendered page content is composed in.
+ *
+ * The pixels are held in client memory in the premultiplied ARGB format, which is what the raster paint engine
+ * works in natively. The render pool delivers its images in that format already, so they are copied into the
+ * framebuffer row by row without any conversion, and the framebuffer is uploaded once per displayed frame when painted.
+ * Every byte moved into, within or out of the framebuffer is counted by the RenderStats set.
+ *
+ * The framebuffer wraps around at its edges, like a torus: a viewport pixel at (x, y) is stored at
+ * ((x + ox) mod width, (y + oy) mod height) for an origin offset (ox, oy). Scrolling merely moves the origin,
+ * the pixels stay where they are, so panning costs nothing but rendering the exposed strips. Any area of the viewport
+ * is stored in up to four pieces, split where it crosses the image edges.
+ */
+class Framebuffer
+{
+
+public:
+
+    /*!
+     * \brief The format of the framebuffer and of all images delivered by the render pool.
+     */
+    static const QImage::Format FORMAT;
+
+    Framebuffer();
+
+    /*!
+     * \brief Sets the statistics the copied bytes are counted by, or Q_NULLPTR to stop counting.
+     */
+    void setStats(RenderStats * const stats);
+
+    bool isNull() const;
+    QSize size() const;
+    QRect rect() const;
+
+    /*!
+     * \brief Copies an area of the viewport out of the framebuffer, unwrapped.
+     */
+    QImage copy(QRect const &rect) const;
+
+    /*!
+     * \brief The whole viewport as an image, which is shared implicitly until the framebuffer is written next,
+     * unless the framebuffer is wrapped and has to be copied.
+     */
+    QImage toImage() const;
+
+    /*!
+     * \brief Resizes the framebuffer, keeping the overlapping pixels at their position.
+     * \param size New size.
+     * \param background Color of the newly exposed area.
+     */
+    void resize(QSize const &size, QColor const &background);
+
+    /*!
+     * \brief Fills an area with a color.
+     */
+    void fill(QRect const &rect, QColor const &color);
+
+    /*!
+     * \brief Moves all pixels by the given distance, by moving the origin offset only.
+     * The exposed area shows the pixels wrapped around from the opposite edge, until rendered anew.
+     */
+    void scroll(int const dx, int const dy);
+
+    /*!
+     * \brief Copies a part of an image unscaled into the framebuffer, clipped to its bounds.
+     * Images in the framebuffer's format, or in the equally laid out opaque RGB32 format, are copied row by row.
+     * \param position Where the top left corner of the source part lands.
+     * \param image The image to copy from.
+     * \param source Part of the image to copy.
+     */
+    void blit(QPoint const &position, QImage const &image, QRect const &source);
+
+    /*!
+     * \brief Draws a part of an image scaled into the framebuffer, smoothly transformed.
+     */
+    void draw(QRectF const &target, QImage const &image, QRectF const &source);
+
+    /*!
+     * \brief Paints an area of the viewport at its place, in up to four pieces.
+     */
+    void paint(QPainter * const painter, QRect const &rect) const;
+
+private:
+
+    int split(QRect const &rect, QRect * const pieces, QPoint * const offsets) const;
+    void countBytes(qint64 const bytes) const;
+
+    QImage mImage;
+    QPoint mOrigin;
+    RenderStats *mStats;
+
+};
+
+} // namespace pdf_viewer
+
+#endif // FRAMEBUFFER_H
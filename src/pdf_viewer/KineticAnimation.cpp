@@ -0,0 +1,85 @@
+#include "KineticAnimation.h"
+
+#include <qmath.h>
+
+namespace pdf_viewer {
+
+const qreal KineticAnimation::TIME_CONSTANT = 325.0;
+const qreal KineticAnimation::MIN_VELOCITY = 0.02;
+
+KineticAnimation::KineticAnimation(
+        QObject * const parent
+)
+    : QAbstractAnimation(parent)
+    , mLastTime(0)
+{
+}
+
+void
+KineticAnimation::fling(
+        QPointF const &velocity
+)
+{
+    stop();
+    mVelocity = velocity;
+    mRemainder = QPointF();
+    mLastTime = 0;
+    start();
+}
+
+QPointF
+KineticAnimation::velocity() const
+{
+    return Running == state() ? mVelocity : QPointF();
+}
+
+int
+KineticAnimation::duration() const
+{
+    return -1;
+}
+
+void
+KineticAnimation::updateCurrentTime(
+        int currentTime
+)
+{
+    qreal const dt = currentTime - mLastTime;
+    mLastTime = currentTime;
+    if(dt <= 0)
+    {
+        return;
+    }
+
+    // The distance covered by an exponentially decaying velocity is v₀·τ·(1 - e^(-t/τ)):
+    qreal const decay = qExp(-dt / TIME_CONSTANT);
+    QPointF const distance = mVelocity * (TIME_CONSTANT * (1 - decay)) + mRemainder;
+    mVelocity *= decay;
+
+    QPoint const delta = distance.toPoint();
+    mRemainder = distance - delta;
+    if(!delta.isNull())
+    {
+        emit step(delta);
+    }
+
+    if(qAbs(mVelocity.x()) < MIN_VELOCITY && qAbs(mVelocity.y()) < MIN_VELOCITY)
+    {
+        stop();
+    }
+}
+
+void
+KineticAnimation::updateState(
+        QAbstractAnimation::State newState,
+        QAbstractAnimation::State
+)
+{
+    if(Stopped == newState)
+    {
+        mVelocity = QPointF();
+        mRemainder = QPointF();
+    }
+}
+
+} // namespace pdf_viewer
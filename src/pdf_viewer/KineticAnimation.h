@@ -0,0 +1,81 @@
+#ifndef KINETICANIMATION_H
+#define KINETICANIMATION_H
+
+#include <QAbstractAnimation>
+#include <QPoint>
+#include <QPointF>
+
+#ifndef Q_NULLPTR
+#define Q_NULLPTR NULL
+#endif // Q_NULLPTR
+
+namespace pdf_viewer {
+
+/*!
+ * \class KineticAnimation
+ * \brief Keeps panning after a flick, at a velocity decaying exponentially as if slowed down by friction.
+ *
+ * Like the page slides, the animation is ticked by Qt's unified animation timer at display rate. The
+ * distance travelled between two ticks is integrated exactly from the decaying velocity, so the total
+ * distance of a flick does not depend on the frame rate. Fractions of pixels are carried over to the
+ * next tick. The animation stops on its own as soon as the velocity has become negligible.
+ */
+class KineticAnimation : public QAbstractAnimation
+{
+
+    Q_OBJECT
+
+public:
+
+    explicit KineticAnimation(QObject * const parent = Q_NULLPTR);
+
+    /*!
+     * \brief Starts the animation, or continues it at a new velocity.
+     * \param velocity Initial velocity in pixels per millisecond.
+     */
+    void fling(QPointF const &velocity);
+
+    /*!
+     * \brief The current velocity in pixels per millisecond, zero while stopped.
+     */
+    QPointF velocity() const;
+
+    /*!
+     * \brief Runs until stopped, or until the velocity has decayed.
+     */
+    virtual int duration() const;
+
+    /*!
+     * \brief Time in milliseconds in which the velocity decays to 1/e.
+     */
+    static const qreal TIME_CONSTANT;
+
+    /*!
+     * \brief Velocity in pixels per millisecond below which the animation stops.
+     */
+    static const qreal MIN_VELOCITY;
+
+signals:
+
+    /*!
+     * \brief Emitted on each tick in which the pan moves by at least one pixel.
+     * \param delta Pixels to pan by.
+     */
+    void step(QPoint delta);
+
+protected:
+
+    virtual void updateCurrentTime(int currentTime);
+    virtual void updateState(QAbstractAnimation::State newState, QAbstractAnimation::State oldState);
+
+private:
+
+    QPointF mVelocity;
+    QPointF mRemainder;
+    int mLastTime;
+
+};
+
+} // namespace pdf_viewer
+
+#endif // KINETICANIMATION_H
@@ -0,0 +1,140 @@
+#include "PdfThumbnail.h"
+
+#include <QPainter>
+
+namespace pdf_viewer {
+
+PdfThumbnail::PdfThumbnail(
+        QDeclarativeItem * const parent
+)
+    : QDeclarativeItem(parent)
+    , mPageNumber(-1)
+    , mPlaceholderColor(Qt::white)
+{
+    setFlag(QGraphicsItem::ItemHasNoContents, false);
+    setSmooth(true);
+
+    connect(this, SIGNAL(widthChanged()), this, SLOT(requestUpdate()));
+    connect(this, SIGNAL(heightChanged()), this, SLOT(requestUpdate()));
+}
+
+PdfThumbnails *
+PdfThumbnail::thumbnails() const
+{
+    return mThumbnails;
+}
+
+void
+PdfThumbnail::setThumbnails(
+        PdfThumbnails * const thumbnails
+)
+{
+    if(thumbnails != mThumbnails)
+    {
+        if(mThumbnails)
+        {
+            disconnect(mThumbnails, Q_NULLPTR, this, Q_NULLPTR);
+        }
+
+        mThumbnails = thumbnails;
+        if(mThumbnails)
+        {
+            connect(mThumbnails, SIGNAL(thumbnailReady(int)), this, SLOT(updateIfShown(int)));
+            connect(mThumbnails, SIGNAL(sourceChanged()), this, SLOT(requestUpdate()));
+            connect(mThumbnails, SIGNAL(thumbnailSizeChanged()), this, SLOT(requestUpdate()));
+        }
+
+        emit thumbnailsChanged();
+        update();
+    }
+}
+
+int
+PdfThumbnail::pageNumber() const
+{
+    return mPageNumber;
+}
+
+void
+PdfThumbnail::setPageNumber(
+        int const pageNumber
+)
+{
+    if(pageNumber != mPageNumber)
+    {
+        mPageNumber = pageNumber;
+        emit pageNumberChanged();
+        update();
+    }
+}
+
+QColor
+PdfThumbnail::placeholderColor() const
+{
+    return mPlaceholderColor;
+}
+
+void
+PdfThumbnail::setPlaceholderColor(
+        QColor const placeholderColor
+)
+{
+    if(placeholderColor != mPlaceholderColor)
+    {
+        mPlaceholderColor = placeholderColor;
+        emit placeholderColorChanged();
+        update();
+    }
+}
+
+void
+PdfThumbnail::updateIfShown(
+        int const pageNumber
+)
+{
+    if(pageNumber == mPageNumber)
+    {
+        update();
+    }
+}
+
+void
+PdfThumbnail::requestUpdate()
+{
+    update();
+}
+
+void
+PdfThumbnail::paint(
+        QPainter * const painter,
+        QStyleOptionGraphicsItem const * const,
+        QWidget * const
+)
+{
+    if(!mThumbnails)
+    {
+        return;
+    }
+
+    QSize const pageSize = mThumbnails->pageSize(mPageNumber);
+    if(pageSize.isEmpty())
+    {
+        return;
+    }
+
+    // Fit the page into the item, centered:
+    QSizeF const size = QSizeF(pageSize).scaled(QSizeF(width(), height()), Qt::KeepAspectRatio);
+    QRectF const target(QPointF((width() - size.width()) / 2, (height() - size.height()) / 2), size);
+
+    QImage const thumbnail = mThumbnails->thumbnail(mPageNumber);
+    if(thumbnail.isNull())
+    {
+        painter->fillRect(target, mPlaceholderColor);
+        return;
+    }
+
+    painter->setRenderHint(QPainter::SmoothPixmapTransform, smooth());
+    painter->drawImage(target, thumbnail);
+}
+
+} // namespace pdf_viewer
@@ -0,0 +1,80 @@
+#ifndef PDFTHUMBNAIL_H
+#define PDFTHUMBNAIL_H
+
+#include <QDeclarativeItem>
+#include <QPointer>
+
+#include "PdfThumbnails.h"
+
+#ifndef Q_NULLPTR
+#define Q_NULLPTR NULL
+#endif // Q_NULLPTR
+
+namespace pdf_viewer {
+
+/*!
+ * \class PdfThumbnail
+ * \brief A QML item showing the thumbnail of a single page.
+ * The thumbnail is scaled to fit into the item, keeping its aspect ratio. Until it has been rendered,
+ * a blank page is shown in its place.
+ */
+class PdfThumbnail : public QDeclarativeItem
+{
+
+    Q_OBJECT
+
+public:
+
+    /*!
+     * \brief The thumbnail set the page is taken from.
+     */
+    Q_PROPERTY(pdf_viewer::PdfThumbnails *thumbnails READ thumbnails WRITE setThumbnails NOTIFY thumbnailsChanged)
+
+    /*!
+     * \brief The zero based number of the page shown.
+     */
+    Q_PROPERTY(int pageNumber READ pageNumber WRITE setPageNumber NOTIFY pageNumberChanged)
+
+    /*!
+     * \brief The color of the page shown while its thumbnail is not available yet.
+     */
+    Q_PROPERTY(QColor placeholderColor READ placeholderColor WRITE setPlaceholderColor NOTIFY placeholderColorChanged)
+
+    PdfThumbnail(QDeclarativeItem * const parent = Q_NULLPTR);
+
+    PdfThumbnails *thumbnails() const;
+    int pageNumber() const;
+    QColor placeholderColor() const;
+
+public slots:
+
+    void setThumbnails(PdfThumbnails * const thumbnails);
+    void setPageNumber(int const pageNumber);
+    void setPlaceholderColor(QColor const placeholderColor);
+
+signals:
+
+    void thumbnailsChanged();
+    void pageNumberChanged();
+    void placeholderColorChanged();
+
+protected:
+
+    virtual void paint(QPainter * const painter, QStyleOptionGraphicsItem const * const option, QWidget * const widget);
+
+private slots:
+
+    void updateIfShown(int const pageNumber);
+    void requestUpdate();
+
+private:
+
+    QPointer<PdfThumbnails> mThumbnails;
+    int mPageNumber;
+    QColor mPlaceholderColor;
+
+};
+
+} // namespace pdf_viewer
+
+#endif // PDFTHUMBNAIL_H
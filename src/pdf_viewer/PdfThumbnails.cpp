@@ -0,0 +1,230 @@
+#include "PdfThumbnails.h"
+#include "DocumentRegistry.h"
+
+#include <QMetaObject>
+
+namespace pdf_viewer {
+
+const int PdfThumbnails::BATCH_SIZE = 16;
+
+PdfThumbnails::PdfThumbnails(
+        QObject * const parent
+)
+    : QObject(parent)
+    , mCurrentPage(0)
+    , mThumbnailSize(128)
+{
+}
+
+QString
+PdfThumbnails::source() const
+{
+    return mSource;
+}
+
+void
+PdfThumbnails::setSource(
+        QString const &source
+)
+{
+    if(source != mSource)
+    {
+        if(mDocument)
+        {
+            disconnect(mDocument.data(), Q_NULLPTR, this, Q_NULLPTR);
+        }
+        mDocument = DocumentRegistry::acquire(source);
+        connect(mDocument.data(), SIGNAL(loaded()), this, SLOT(receiveLoadedDocument()));
+        connect(mDocument.data(), SIGNAL(pagesRecovered()), this, SLOT(receiveLoadedDocument()));
+        connect(mDocument.data(), SIGNAL(rendered(pdf_viewer::RenderJob,QImage)), this, SLOT(receiveRenderedImage(pdf_viewer::RenderJob,QImage)));
+        mPendingPages.clear();
+        mRenderedPages.clear();
+
+        mSource = source;
+        emit sourceChanged();
+        emit countChanged();
+
+        requestBatch();
+    }
+}
+
+void
+PdfThumbnails::receiveLoadedDocument()
+{
+    // Pages are only known once the document has been opened, or recovered from the disk cache:
+    emit countChanged();
+    requestBatch();
+}
+
+int
+PdfThumbnails::currentPage() const
+{
+    return mCurrentPage;
+}
+
+void
+PdfThumbnails::setCurrentPage(
+        int const currentPage
+)
+{
+    // The next batch is taken around the new page:
+    if(currentPage != mCurrentPage)
+    {
+        mCurrentPage = currentPage;
+        emit currentPageChanged();
+    }
+}
+
+int
+PdfThumbnails::thumbnailSize() const
+{
+    return mThumbnailSize;
+}
+
+void
+PdfThumbnails::setThumbnailSize(
+        int thumbnailSize
+)
+{
+    thumbnailSize = qMax(1, thumbnailSize);
+    if(thumbnailSize != mThumbnailSize)
+    {
+        mThumbnailSize = thumbnailSize;
+        emit thumbnailSizeChanged();
+
+        // Pending thumbnails still arrive, but at the old size they are not waited for anymore:
+        mPendingPages.clear();
+        mRenderedPages.clear();
+        requestBatch();
+    }
+}
+
+int
+PdfThumbnails::count() const
+{
+    return mDocument ? mDocument->pageCount() : 0;
+}
+
+QImage
+PdfThumbnails::thumbnail(
+        int const pageNumber
+)
+{
+    if(pageNumber < 0 || pageNumber >= count())
+    {
+        return QImage();
+    }
+
+    QImage const image = mDocument->thumbnailCache().tile(thumbnailKey(pageNumber));
+    if(image.isNull() && mRenderedPages.remove(pageNumber))
+    {
+        // Evicted from the cache, render it again with the next batch:
+        QMetaObject::invokeMethod(this, "requestBatch", Qt::QueuedConnection);
+    }
+    return image;
+}
+
+QSize
+PdfThumbnails::pageSize(
+        int const pageNumber
+) const
+{
+    if(pageNumber < 0 || pageNumber >= count())
+    {
+        return QSize();
+    }
+    return mDocument->pageSize(pageNumber);
+}
+
+TileKey
+PdfThumbnails::thumbnailKey(
+        int const pageNumber,
+        qreal * const scale
+) const
+{
+    // The longer page edge is scaled to the thumbnail size:
+    QSize const size = mDocument->pageSize(pageNumber);
+    qreal const thumbnailScale = static_cast<qreal>(mThumbnailSize) / qMax(1, qMax(size.width(), size.height()));
+    if(scale)
+    {
+        *scale = thumbnailScale;
+    }
+    return TileKey::thumbnail(pageNumber, thumbnailScale);
+}
+
+void
+PdfThumbnails::requestBatch()
+{
+    // The next batch is only requested once the previous one is done, so a change of the current page takes effect soon:
+    if(!mPendingPages.isEmpty())
+    {
+        return;
+    }
+
+    // Missing thumbnails nearest to the current page first, alternating between following and preceding pages:
+    int const pageCount = count();
+    int const center = qBound(0, mCurrentPage, qMax(0, pageCount - 1));
+    for(int distance = 0; mPendingPages.size() < BATCH_SIZE && (center - distance >= 0 || center + distance < pageCount); distance++)
+    {
+        int const neighbours[] = { center + distance, center - distance };
+        for(int i = 0; i < (distance > 0 ? 2 : 1); i++)
+        {
+            int const pageNumber = neighbours[i];
+            if(pageNumber < 0 || pageNumber >= pageCount)
+            {
+                continue;
+            }
+
+            // Every page is rendered once, so a cache too small for all thumbnails does not keep the batches going forever:
+            qreal scale;
+            TileKey const key = thumbnailKey(pageNumber, &scale);
+            if(mRenderedPages.contains(pageNumber) || mPendingPages.contains(pageNumber))
+            {
+                continue;
+            }
+            if(!mDocument->thumbnailCache().tile(key).isNull())
+            {
+                mRenderedPages.insert(pageNumber);
+                continue;
+            }
+
+            RenderJob job;
+            job.key = key;
+            job.pageNumber = pageNumber;
+            job.scale = scale;
+            job.orientation = 0;
+            job.rect = QRect(QPoint(0, 0), mDocument->pageSize(pageNumber) * scale);
+            job.target = RenderJob::THUMBNAIL;
+            job.priority = RenderJob::BACKGROUND;
+            mDocument->render(job);
+            mPendingPages.insert(pageNumber);
+        }
+    }
+}
+
+void
+PdfThumbnails::receiveRenderedImage(
+        RenderJob const &job,
+        QImage const &image
+)
+{
+    // The shared document has already cached the image, which might as well have been requested by someone else:
+    if(RenderJob::THUMBNAIL != job.target || !(job.key == thumbnailKey(job.pageNumber)))
+    {
+        return;
+    }
+
+    // A page which could not be rasterized counts as done, so the batches keep going, but there is nothing to show:
+    mRenderedPages.insert(job.pageNumber);
+    if(!image.isNull())
+    {
+        emit thumbnailReady(job.pageNumber);
+    }
+
+    if(mPendingPages.remove(job.pageNumber) && mPendingPages.isEmpty())
+    {
+        requestBatch();
+    }
+}
+
+} // namespace pdf_viewer
@@ -0,0 +1,116 @@
+#ifndef PDFTHUMBNAILS_H
+#define PDFTHUMBNAILS_H
+
+#include <QObject>
+#include <QImage>
+#include <QSet>
+#include <QSharedPointer>
+
+#include "RenderPool.h"
+#include "SharedDocument.h"
+
+#ifndef Q_NULLPTR
+#define Q_NULLPTR NULL
+#endif // Q_NULLPTR
+
+namespace pdf_viewer {
+
+/*!
+ * \class PdfThumbnails
+ * \brief Renders low resolution thumbnails of all pages of a document in the background.
+ *
+ * Thumbnails are rendered in small batches on the document's render pool, behind anything a viewer
+ * is waiting for. Each batch takes the missing thumbnails nearest to the current page, so moving the
+ * current page reprioritizes the remaining work as soon as the running batch is done. Thumbnails are
+ * cached by the shared document, so they are reused by any other thumbnail set on the same file.
+ * They are displayed by PdfThumbnail items, e.g. as delegates of a grid view with a model of `count`.
+ */
+class PdfThumbnails : public QObject
+{
+
+    Q_OBJECT
+
+public:
+
+    /*!
+     * \brief The document file path, usually bound to the viewer's source.
+     */
+    Q_PROPERTY(QString source READ source WRITE setSource NOTIFY sourceChanged)
+
+    /*!
+     * \brief The page the user is looking at, usually bound to the viewer's page number.
+     * Thumbnails of pages around it are rendered first.
+     */
+    Q_PROPERTY(int currentPage READ currentPage WRITE setCurrentPage NOTIFY currentPageChanged)
+
+    /*!
+     * \brief Length of the longer thumbnail edge in pixels.
+     */
+    Q_PROPERTY(int thumbnailSize READ thumbnailSize WRITE setThumbnailSize NOTIFY thumbnailSizeChanged)
+
+    /*!
+     * \brief Number of pages, zero if the document cannot be shown.
+     */
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+
+    explicit PdfThumbnails(QObject * const parent = Q_NULLPTR);
+
+    QString source() const;
+    int currentPage() const;
+    int thumbnailSize() const;
+    int count() const;
+
+    /*!
+     * \brief The thumbnail of a page.
+     * \return The thumbnail, or a null image if it has not been rendered yet.
+     * A thumbnail evicted from the cache meanwhile is rendered again.
+     */
+    QImage thumbnail(int const pageNumber);
+
+    /*!
+     * \brief Size of a page in points, as a placeholder can be shown at the right aspect ratio.
+     */
+    QSize pageSize(int const pageNumber) const;
+
+public slots:
+
+    void setSource(QString const &source);
+    void setCurrentPage(int const currentPage);
+    void setThumbnailSize(int thumbnailSize);
+
+signals:
+
+    void sourceChanged();
+    void currentPageChanged();
+    void thumbnailSizeChanged();
+    void countChanged();
+
+    /*!
+     * \brief Emitted as soon as the thumbnail of a page is available.
+     */
+    void thumbnailReady(int pageNumber);
+
+private slots:
+
+    void requestBatch();
+    void receiveLoadedDocument();
+    void receiveRenderedImage(pdf_viewer::RenderJob const &job, QImage const &image);
+
+private:
+
+    TileKey thumbnailKey(int const pageNumber, qreal *scale = Q_NULLPTR) const;
+
+    QString mSource;
+    QSharedPointer<SharedDocument> mDocument;
+    int mCurrentPage;
+    int mThumbnailSize;
+    QSet<int> mPendingPages;
+    QSet<int> mRenderedPages;
+
+    static const int BATCH_SIZE;
+
+};
+
+} // namespace pdf_viewer
+
+#endif // PDFTHUMBNAILS_H
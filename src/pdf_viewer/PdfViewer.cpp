@@ -1,4 +1,5 @@
 #include "PdfViewer.h"
+#include "DocumentRegistry.h"
 
 #include <QTimer>
 #include <QPainter>
@@ -17,6 +18,19 @@ equalReals(qreal const a, qreal const b, int const precision = 1000);
 
 const qreal PdfViewer::SLIDE_ANIMATION_DURATION = 150.0;
 const int PdfViewer::SLIDE_PULL_THRESHOLD = 100;
+const int PdfViewer::ZOOM_SETTLE_INTERVAL = 150;
+const int PdfViewer::PAGE_SPACING = 8;
+const int PdfViewer::MAX_SEARCH_HITS = 1000;
+const int PdfViewer::FLICK_RELEASE_INTERVAL = 100;
+const int PdfViewer::PREFETCH_LOOKAHEAD = 300;
+const int PdfViewer::REFINEMENT_DELAY = 250;
+const int PdfViewer::MIN_LEVEL = -3;
+const int PdfViewer::MAX_LEVEL = 3;
+const qint64 PdfViewer::MAX_LEVEL_PIXELS = 1 << 21;
+const qint64 PdfViewer::MAX_WHOLE_PAGE_PIXELS = 1 << 22;
+const int PdfViewer::RENDER_DEADLINE = 100;
+const int PdfViewer::PREVIEW_LEVEL_OFFSET = 2;
+const int PdfViewer::EXPENSIVE_PREFETCH_FACTOR = 2;
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////
 /////////////////////        PDF Viewer
@@ -25,34 +39,92 @@ const int PdfViewer::SLIDE_PULL_THRESHOLD = 100;
 PdfViewer::PdfViewer(QDeclarativeItem * const parent)
     : QDeclarativeItem(parent)
     , mStatus(NOT_OPEN)
-    , mDocument(Q_NULLPTR)
-    , mPage(Q_NULLPTR)
     , mPageNumber(-1)
     , mInfo(new PdfDocument(this))
+    , mPanScale(0)
     , mZoom(fitZoom())
     , mMaxZoom(6)
     , mPageOrientation(ZERO_PI)
+    , mFramebufferScale(0)
     , mRenderTextAntiAliased(false)
+    , mRenderImageAntiAliased(false)
+    , mSlidingPull(0)
     , mSlidingOutPage(false)
-    , mSlidingPolynomial(3)
+    , mSlidingImagePending(false)
+    , mSlidingOffset(0)
+    , mSlidingFrameTime(0)
+    , mSlideAnimation(new SlideAnimation(this))
+    , mKineticScrolling(true)
+    , mKineticAnimation(new KineticAnimation(this))
+    , mInteractionQuality(NOT_ANTI_ALIASED)
+    , mInteracting(false)
+    , mRefinementPending(false)
+    , mRefinementTimer(new QTimer(this))
+    , mTileCacheBudget(64 * 1024 * 1024)
+    , mDiskCacheSize(256)
+    , mGeneration(0)
+    , mDeadlineTimer(new QTimer(this))
+    , mPrefetchRadius(2)
+    , mPrefetchTimer(new QTimer(this))
+    , mZoomSettleTimer(new QTimer(this))
+    , mZoomPreviewScale(1)
+    , mKeepStaleContent(false)
+    , mStaleContentScale(0)
+    , mBusy(false)
+    , mViewTransformValid(false)
+    , mContinuous(false)
+    , mLayoutWidth(0)
+    , mStats(new RenderStats(this))
 {
+    mFramebuffer.setStats(mStats);
+
     setFlag(QGraphicsItem::ItemHasNoContents, false);
     setFlag(QGraphicsItem::ItemIsFocusable, true);
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption, true); // Paint only the exposed rect
     setAcceptedMouseButtons(Qt::LeftButton | Qt::RightButton | Qt::MiddleButton);
     setAcceptTouchEvents(true);
     setAcceptHoverEvents(false);
     setSmooth(false); // Anti-aliasing is done by Poppler itself
     setFocus(true);
 
-    connect(this, SIGNAL(widthChanged()), this, SLOT(allocateFramebuffer()));
-    connect(this, SIGNAL(heightChanged()), this, SLOT(allocateFramebuffer()));
+    // Page slides are paced by the display rate:
+    connect(mSlideAnimation, SIGNAL(frame(int)), this, SLOT(showSlideFrame(int)));
+    connect(mSlideAnimation, SIGNAL(finished()), this, SLOT(finishSlide()));
+
+    // Flicked pages keep moving for a while:
+    connect(mKineticAnimation, SIGNAL(step(QPoint)), this, SLOT(kineticStep(QPoint)));
+
+    // Content rendered fast while interacting is refined once the interaction has ended:
+    mRefinementTimer->setSingleShot(true);
+    mRefinementTimer->setInterval(REFINEMENT_DELAY);
+    connect(mRefinementTimer, SIGNAL(timeout()), this, SLOT(refine()));
+
+    // Neighbouring pages are prefetched once the viewer has become idle:
+    mPrefetchTimer->setSingleShot(true);
+    mPrefetchTimer->setInterval(250);
+    connect(mPrefetchTimer, SIGNAL(timeout()), this, SLOT(prefetchNeighbourPages()));
+
+    // Visible tiles missing their deadline get a coarse preview to stand in for them:
+    mDeadlineTimer->setSingleShot(true);
+    mDeadlineTimer->setInterval(RENDER_DEADLINE);
+    connect(mDeadlineTimer, SIGNAL(timeout()), this, SLOT(previewMissedDeadline()));
+
+    // While zoom is changing, a transformed preview is shown and rendering is deferred until zoom has settled:
+    mZoomSettleTimer->setSingleShot(true);
+    mZoomSettleTimer->setInterval(ZOOM_SETTLE_INTERVAL);
+    connect(mZoomSettleTimer, SIGNAL(timeout()), this, SLOT(settleZoom()));
+    connect(this, SIGNAL(zoomChanged()), mZoomSettleTimer, SLOT(start()));
+    connect(this, SIGNAL(zoomChanged()), this, SLOT(updateBusy()));
+    connect(this, SIGNAL(statusChanged()), this, SLOT(updateBusy()));
+    connect(this, SIGNAL(sourceChanged()), this, SLOT(discardZoomPreview()));
+    connect(this, SIGNAL(pageOrientationChanged()), this, SLOT(discardZoomPreview()));
+
+    // The framebuffer is resized on the next paint, so a change of width and height is handled at once:
+    connect(this, SIGNAL(widthChanged()), this, SLOT(scheduleFramebufferResize()));
+    connect(this, SIGNAL(heightChanged()), this, SLOT(scheduleFramebufferResize()));
 
     connect(this, SIGNAL(sourceChanged()), this, SLOT(requestRenderWholePdf()));
-    connect(this, SIGNAL(widthChanged()), this, SLOT(requestRenderWholePdf()));
-    connect(this, SIGNAL(heightChanged()), this, SLOT(requestRenderWholePdf()));
-    connect(this, SIGNAL(pageNumberChanged()), this, SLOT(requestRenderWholePdf()));
     connect(this, SIGNAL(pageOrientationChanged()), this, SLOT(requestRenderWholePdf()));
-    connect(this, SIGNAL(zoomChanged()), this, SLOT(requestRenderWholePdf()));
 
     connect(this, SIGNAL(widthChanged()), this, SIGNAL(coverZoomChanged()));
     connect(this, SIGNAL(heightChanged()), this, SIGNAL(coverZoomChanged()));
@@ -65,9 +137,7 @@ PdfViewer::PdfViewer(QDeclarativeItem * const parent)
 
 PdfViewer::~PdfViewer()
 {
-    // Release resources acquired from Poppler:
-    delete mPage;
-    delete mDocument;
+    // The document itself is closed once no other viewer shows it
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -87,44 +157,111 @@ PdfViewer::setSource(
 {
     if(source != mSource)
     {
-        // Release page object:
-        delete mPage;
-        mPage = Q_NULLPTR;
-
-        // Open new document:
-        delete mDocument;
-        mDocument = Poppler::Document::load(source);
-
-        // Emit new source signal as soon as new document object is retrieved:
+        // Forget the page of the previous document, nothing is shown until the new one has been opened:
+        mKineticAnimation->stop();
+        mPageNumber = -1;
+        setStatus(LOADING);
+        invalidateViewTransform();
+
+        // Open new document in the background, or share it with other viewers which have already opened it.
+        // A previous document still loading is cancelled, unless another viewer is waiting for it as well.
+        // Rasterization happens in the background too, finished images are composited as they arrive:
+        if(mDocument)
+        {
+            cancelObsoleteJobs();
+            disconnect(mDocument.data(), Q_NULLPTR, this, Q_NULLPTR);
+        }
+        mDocument = DocumentRegistry::acquire(source);
+        mDocument->tileCache().setBudget(mTileCacheBudget);
+        applyDiskCache();
+        connect(mDocument.data(), SIGNAL(loaded()), this, SLOT(openLoadedDocument()));
+        connect(mDocument.data(), SIGNAL(pagesRecovered()), this, SLOT(openRecoveredPages()));
+        connect(mDocument.data(), SIGNAL(rendered(pdf_viewer::RenderJob,QImage)), this, SLOT(composeRenderedImage(pdf_viewer::RenderJob,QImage)));
+        connect(mDocument.data(), SIGNAL(cancelled(pdf_viewer::RenderJob)), this, SLOT(dropCancelledJob(pdf_viewer::RenderJob)));
+        connect(mDocument.data(), SIGNAL(renderCostMeasured(int)), this, SLOT(updatePageRenderCost(int)));
+        connect(mDocument.data(), SIGNAL(textIndexProgressed()), this, SIGNAL(textIndexProgressChanged()));
+        mPendingTiles.clear();
+        mExpensivePages.clear();
+        updateLayout();
+
+        // Emit new source signal as soon as new document object is retrieved, its information follows once it has been opened:
         mSource = source;
-        mInfo->setInformation(mDocument->title(), mDocument->author(), mDocument->creator(), mDocument->creationDate(), mDocument->modificationDate());
+        mInfo->setInformation(QString(), QString(), QString(), QDateTime(), QDateTime());
         emit sourceChanged();
         emit infoChanged();
+        emit textIndexProgressChanged();
 
-        // Check whether document is valid:
-        if(!mDocument)
-        {
-            setStatus(CANNOT_OPEN_DOCUMENT);
-            return;
-        }
-        if(mDocument->isLocked())
+        if(!mDocument->isLoading())
         {
-            setStatus(DOCUMENT_IS_LOCKED);
-            return;
+            openLoadedDocument();
         }
-        if(0 == mDocument->numPages())
+        else if(0 != mDocument->pageCount())
         {
-            setStatus(NO_PAGES);
-            return;
+            openRecoveredPages();
         }
-        setStatus(OK);
+    }
+}
+
+void
+PdfViewer::openRecoveredPages()
+{
+    // Pages recovered from the disk cache are shown right away, the document's information follows once it has been parsed:
+    updateLayout();
+    setStatus(OK);
+    showFirstPage();
+}
+
+void
+PdfViewer::openLoadedDocument()
+{
+    bool const pagesRecovered = OK == mStatus;
+    updateLayout();
+    Poppler::Document const * const document = mDocument->document();
+
+    // Check whether document is valid:
+    if(!document)
+    {
+        setStatus(CANNOT_OPEN_DOCUMENT);
+        return;
+    }
+
+    mInfo->setInformation(document->title(), document->author(), document->creator(), document->creationDate(), document->modificationDate());
+    emit infoChanged();
+
+    if(document->isLocked())
+    {
+        setStatus(DOCUMENT_IS_LOCKED);
+        return;
+    }
+    if(0 == mDocument->pageCount())
+    {
+        setStatus(NO_PAGES);
+        return;
+    }
+    setStatus(OK);
 
-        // Enable anti-aliased rendering in Poppler:
-        mDocument->setRenderHint(Poppler::Document::TextAntialiasing, mRenderTextAntiAliased);
+    // Recovered pages have been shown already, the user might have moved on meanwhile:
+    if(pagesRecovered)
+    {
+        requestRenderWholePdf();
+        return;
+    }
+    showFirstPage();
+}
 
-        // Reset page number to zero:
-        setPageNumber(0);
+void
+PdfViewer::showFirstPage()
+{
+    // In continuous mode, the new document is shown from its top at fit zoom:
+    if(mContinuous)
+    {
+        setZoom(fitZoom());
+        discardZoomPreview();
     }
+
+    // Reset page number to zero:
+    setPageNumber(0);
+    requestRenderWholePdf();
 }
 
 int
@@ -143,20 +280,66 @@ PdfViewer::setPageNumber(
         return;
     }
 
-    pageNumber = qBound(0, pageNumber, mDocument->numPages() - 1);
+    pageNumber = qBound(0, pageNumber, mDocument->pageCount() - 1);
 
-    if((pageNumber != mPageNumber) || !mPage)
+    if(mContinuous)
     {
-        mPageNumber = pageNumber;
+        // Scroll to the top of the page, the page number follows on its own. Even if the page is
+        // already the current one, as it might only be partially visible:
+        setPan(QPoint(pan().x(), -pageOrigin(pageNumber).y()));
+
+        // Near the end of the document, the requested page might not make it into the viewport center:
+        if(pageNumber != mPageNumber)
+        {
+            mPageNumber = pageNumber;
+            emit pageNumberChanged();
+        }
+        return;
+    }
 
-        delete mPage;
-        mPage = mDocument->page(mPageNumber);
+    if(pageNumber != mPageNumber)
+    {
+        mPageNumber = pageNumber;
+        invalidateViewTransform();
 
         emit pageNumberChanged();
         emit coverZoomChanged();
     }
 }
 
+bool
+PdfViewer::continuous() const
+{
+    return mContinuous;
+}
+
+void
+PdfViewer::setContinuous(
+        bool const continuous
+)
+{
+    if(continuous != mContinuous)
+    {
+        mContinuous = continuous;
+        mKineticAnimation->stop();
+        updateLayout();
+        emit continuousChanged();
+        emit coverZoomChanged();
+
+        // Start over at fit zoom, showing the current page:
+        discardZoomPreview();
+        if(OK == mStatus)
+        {
+            int const pageNumber = mPageNumber;
+            setZoom(fitZoom());
+            discardZoomPreview();
+            setPan(fitPan());
+            setPageNumber(pageNumber);
+        }
+        requestRenderWholePdf();
+    }
+}
+
 PdfViewer::Status
 PdfViewer::status() const
 {
@@ -174,6 +357,9 @@ PdfViewer::statusMessage() const
     case NOT_OPEN:
         return "No document opened";
 
+    case LOADING:
+        return "Loading document";
+
     case NO_PAGES:
         return "Document has no pages";
 
@@ -207,7 +393,7 @@ PdfViewer::setStatus(
 QSize
 PdfViewer::scaledPageQuad() const
 {
-    return QSize(pageQuad().width(), pageQuad().height()) * computeScale();
+    return viewTransform().scaledPageQuad;
 }
 
 QSize PdfViewer::viewport() const
@@ -230,42 +416,53 @@ PdfViewer::setPan(
         QPoint pan
 )
 {
-    static qreal lastZoom;
-    if(mPan != pan || !equalReals(lastZoom, zoom()))
+    if(mPan != pan || !equalReals(mPanScale, computeScale()))
     {
-        lastZoom = zoom();
-
-        bool const scrolling = zoom() > fitZoom() && zoom() <= coverZoom();
-        bool const hScrolling = scrolling && scaledPageQuad().width() > width();
-        bool const vScrolling = scrolling && !hScrolling;
+        mPanScale = computeScale();
 
-        // Restrict pan at certain zoom levels:
-        if(equalReals(zoom(), fitZoom()))
-        {
-            // You cannot pan the page at all when at fit-zoom:
-            pan = fitPan();
-        }
-        if(hScrolling)
+        if(mContinuous)
         {
-            // The page can only be horizontally scrolled:
-            pan.setY(fitPan().y());
+            // The layout is centered horizontally while it is narrower than the viewport, otherwise
+            // it can be scrolled up to its edges, just like vertically:
+            QPoint const translation = pan + zoomPan();
+            QPoint const edge = QPoint(viewport().width(), viewport().height()) - QPoint(scaledPageQuad().width(), scaledPageQuad().height());
+            pan.setX((edge.x() >= 0 ? edge.x() / 2 : qBound(edge.x(), translation.x(), 0)) - zoomPan().x());
+            pan.setY((edge.y() >= 0 ? edge.y() / 2 : qBound(edge.y(), translation.y(), 0)) - zoomPan().y());
         }
-        else if(vScrolling)
+        else
         {
-            // The page can only be vertically scrolled:
-            pan.setX(fitPan().x());
-        }
+            bool const scrolling = zoom() > fitZoom() && zoom() <= coverZoom();
+            bool const hScrolling = scrolling && scaledPageQuad().width() > width();
+            bool const vScrolling = scrolling && !hScrolling;
 
-        // Prevent scrolling over edges:
-        if(zoom() > coverZoom() || vScrolling)
-        {
-            pan.setY(qMin(pan.y(), -zoomPan().y()));
-            pan.setY(qMax(pan.y(), -zoomPan().y() - scaledPageQuad().height() + viewport().height()));
-        }
-        if(zoom() > coverZoom() || hScrolling)
-        {
-            pan.setX(qMin(pan.x(), -zoomPan().x()));
-            pan.setX(qMax(pan.x(), -zoomPan().x() - scaledPageQuad().width() + viewport().width()));
+            // Restrict pan at certain zoom levels:
+            if(equalReals(zoom(), fitZoom()))
+            {
+                // You cannot pan the page at all when at fit-zoom:
+                pan = fitPan();
+            }
+            if(hScrolling)
+            {
+                // The page can only be horizontally scrolled:
+                pan.setY(fitPan().y());
+            }
+            else if(vScrolling)
+            {
+                // The page can only be vertically scrolled:
+                pan.setX(fitPan().x());
+            }
+
+            // Prevent scrolling over edges:
+            if(zoom() > coverZoom() || vScrolling)
+            {
+                pan.setY(qMin(pan.y(), -zoomPan().y()));
+                pan.setY(qMax(pan.y(), -zoomPan().y() - scaledPageQuad().height() + viewport().height()));
+            }
+            if(zoom() > coverZoom() || hScrolling)
+            {
+                pan.setX(qMin(pan.x(), -zoomPan().x()));
+                pan.setX(qMax(pan.x(), -zoomPan().x() - scaledPageQuad().width() + viewport().width()));
+            }
         }
 
         int dx = pan.x() - mPan.x();
@@ -273,27 +470,57 @@ PdfViewer::setPan(
         int const w = viewport().width();
         int const h = viewport().height();
 
-        mFramebuffer.scroll(dx, dy, mFramebuffer.rect(), Q_NULLPTR);
+        // While zoom is settling, the preview is transformed on paint, so there is nothing to scroll or render:
+        bool const zoomSettling = !mZoomPreview.isNull();
+        if(!zoomSettling)
+        {
+            mFramebuffer.scroll(dx, dy);
+        }
 
         mPan = pan;
+        mStats->addPan();
         emit panChanged();
 
+        // In continuous mode, the page number follows the page at the viewport center:
+        if(mContinuous && OK == mStatus)
+        {
+            int const pageNumber = pageAt((h / 2 - pan.y() - zoomPan().y()) / computeScale());
+            if(pageNumber != mPageNumber)
+            {
+                mPageNumber = pageNumber;
+                emit pageNumberChanged();
+            }
+        }
+
+        if(zoomSettling)
+        {
+            update();
+            return;
+        }
+
+        // Areas still waiting to be rendered have been scrolled along with the framebuffer:
+        mRenderRegion.translate(dx, dy);
+
+        // Accumulate the exposed strips, they are rendered at once on the next paint. The region
+        // merges overlapping strips, so the corner of a diagonal move is not rendered twice, and
+        // a burst of mouse moves between two frames results in a single render:
         if(dy > 0)
         {
-            renderPdfIntoFramebuffer(QRect(0, 0, w, dy));
+            mRenderRegion += QRect(0, 0, w, dy);
         }
         if(dy < 0)
         {
-            renderPdfIntoFramebuffer(QRect(0, h + dy, w, -dy));
+            mRenderRegion += QRect(0, h + dy, w, -dy);
         }
         if(dx > 0)
         {
-            renderPdfIntoFramebuffer(QRect(0, 0, dx, h));
+            mRenderRegion += QRect(0, 0, dx, h);
         }
         if(dx < 0)
         {
-            renderPdfIntoFramebuffer(QRect(w + dx, 0, -dx, h));
+            mRenderRegion += QRect(w + dx, 0, -dx, h);
         }
+        mRenderRegion &= QRect(0, 0, w, h);
 
         update();
     }
@@ -302,24 +529,24 @@ PdfViewer::setPan(
 QPoint
 PdfViewer::fitPan() const
 {
-    return QPoint(
-        qRound(viewport().width() - pageQuad().width() * fitScale()) / 2,
-        qRound(viewport().height() - pageQuad().height() * fitScale()) / 2
-    );
+    return viewTransform().fitPan;
 }
 
 QPoint
 PdfViewer::coverPan() const
 {
-    return QPoint(
-                (qRound(pageQuad().width() * (coverScale() - fitScale()))) / 2,
-                (qRound(pageQuad().height() * (coverScale() - fitScale()))) / 2);
+    return viewTransform().coverPan;
 }
 
 void
 PdfViewer::resetToFitPanIfFitZoom()
 {
-    if(!mSlidingOutPage && equalReals(zoom(), fitZoom()))
+    if(mContinuous)
+    {
+        // Stay at the current scroll position, as far as the layout allows:
+        setPan(pan());
+    }
+    else if(!mSlidingOutPage && equalReals(zoom(), fitZoom()))
     {
         setPan(fitPan());
     }
@@ -343,10 +570,83 @@ PdfViewer::setZoom(
     zoom = qBound(fitZoom(), zoom, mMaxZoom);
     if(!equalReals(mZoom, zoom))
     {
+        cancelObsoleteJobs();
+
+        // Keep the last sharp frame, it is shown transformed until zoom has settled:
+        if(mZoomPreview.isNull() && !mFramebuffer.isNull())
+        {
+            mZoomPreview = mFramebuffer.toImage();
+            mZoomPreviewScale = computeScale();
+            mZoomPreviewTranslation = pan() + zoomPan();
+        }
+
+        // In continuous mode, the layout point at the viewport center stays in place:
+        QPoint const center(viewport().width() / 2, viewport().height() / 2);
+        QPointF const anchor = QPointF(center - pan() - zoomPan()) / computeScale();
+
         mZoom = zoom;
+        invalidateViewTransform();
         emit zoomChanged();
 
-        setPan(pan());
+        setPan(mContinuous ? center - zoomPan() - (anchor * computeScale()).toPoint() : pan());
+    }
+}
+
+QRectF
+PdfViewer::zoomPreviewRect() const
+{
+    // A point of the preview at v maps to the page point v - t0 at the preview scale, which is
+    // at (v - t0) * factor at the current scale, and finally appears at t1 + (v - t0) * factor:
+    qreal const factor = computeScale() / mZoomPreviewScale;
+    QPointF const translation = pan() + zoomPan();
+    return QRectF(translation - QPointF(mZoomPreviewTranslation) * factor, QSizeF(mZoomPreview.size()) * factor);
+}
+
+void
+PdfViewer::settleZoom()
+{
+    if(mZoomPreview.isNull())
+    {
+        requestRenderWholePdf();
+        return;
+    }
+
+    // Bake the preview into the framebuffer, so it remains visible where sharp tiles are still missing:
+    if(!mFramebuffer.isNull())
+    {
+        mFramebuffer.fill(mFramebuffer.rect(), mBackgroundColor);
+        mFramebuffer.draw(zoomPreviewRect(), mZoomPreview, QRectF(mZoomPreview.rect()));
+    }
+    mZoomPreview = QImage();
+    mKeepStaleContent = true;
+    mStaleContentScale = mZoomPreviewScale;
+
+    requestRenderWholePdf();
+}
+
+void
+PdfViewer::discardZoomPreview()
+{
+    mZoomSettleTimer->stop();
+    mZoomPreview = QImage();
+}
+
+int
+PdfViewer::zoomSettleInterval() const
+{
+    return mZoomSettleTimer->interval();
+}
+
+void
+PdfViewer::setZoomSettleInterval(
+        int zoomSettleInterval
+)
+{
+    zoomSettleInterval = qMax(0, zoomSettleInterval);
+    if(zoomSettleInterval != mZoomSettleTimer->interval())
+    {
+        mZoomSettleTimer->setInterval(zoomSettleInterval);
+        emit zoomSettleIntervalChanged();
     }
 }
 
@@ -402,10 +702,7 @@ PdfViewer::setRenderTextAntiAliased(
         mRenderTextAntiAliased = on;
         emit renderTextAntiAliasedChanged();
 
-        if(mDocument)
-        {
-            mDocument->setRenderHint(Poppler::Document::TextAntialiasing, mRenderTextAntiAliased);
-        }
+        discardTiles();
     }
 }
 
@@ -424,13 +721,112 @@ PdfViewer::setRenderImageAntiAliased(
         mRenderImageAntiAliased = on;
         emit renderTextAntiAliasedChanged();
 
+        discardTiles();
+    }
+}
+
+int
+PdfViewer::tileCacheBudget() const
+{
+    return mTileCacheBudget;
+}
+
+void
+PdfViewer::setTileCacheBudget(
+        int const budget
+)
+{
+    if(budget != mTileCacheBudget)
+    {
+        mTileCacheBudget = budget;
         if(mDocument)
         {
-            mDocument->setRenderHint(Poppler::Document::Antialiasing, mRenderImageAntiAliased);
+            mDocument->tileCache().setBudget(budget);
         }
+        emit tileCacheBudgetChanged();
+    }
+}
+
+QString
+PdfViewer::diskCacheDirectory() const
+{
+    return mDiskCacheDirectory;
+}
+
+void
+PdfViewer::setDiskCacheDirectory(
+        QString const &diskCacheDirectory
+)
+{
+    if(diskCacheDirectory != mDiskCacheDirectory)
+    {
+        mDiskCacheDirectory = diskCacheDirectory;
+        applyDiskCache();
+        emit diskCacheDirectoryChanged();
     }
 }
 
+int
+PdfViewer::diskCacheSize() const
+{
+    return mDiskCacheSize;
+}
+
+void
+PdfViewer::setDiskCacheSize(
+        int diskCacheSize
+)
+{
+    diskCacheSize = qMax(0, diskCacheSize);
+    if(diskCacheSize != mDiskCacheSize)
+    {
+        mDiskCacheSize = diskCacheSize;
+        applyDiskCache();
+        emit diskCacheSizeChanged();
+    }
+}
+
+void
+PdfViewer::applyDiskCache()
+{
+    if(!mDocument)
+    {
+        return;
+    }
+
+    mDocument->setDiskCache(mDiskCacheDirectory.isEmpty()
+                            ? QSharedPointer<DiskCache>()
+                            : DiskCache::open(mDiskCacheDirectory, static_cast<qint64>(mDiskCacheSize) * 1024 * 1024));
+}
+
+int
+PdfViewer::prefetchRadius() const
+{
+    return mPrefetchRadius;
+}
+
+void
+PdfViewer::setPrefetchRadius(
+        int prefetchRadius
+)
+{
+    prefetchRadius = qMax(0, prefetchRadius);
+    if(prefetchRadius != mPrefetchRadius)
+    {
+        mPrefetchRadius = prefetchRadius;
+        emit prefetchRadiusChanged();
+    }
+}
+
+void
+PdfViewer::discardTiles()
+{
+    // Tiles have been rendered with other settings, which are part of the tile key. Other viewers
+    // may still use the old tiles, so they are left to the cache, and the view is just rendered again:
+    mPendingTiles.clear();
+    requestRenderWholePdf();
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////
 /////////////////////        Background color
 /////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -455,9 +851,14 @@ PdfViewer::setBackgroundColor(
 
 void PdfViewer::resetPageViewToFit()
 {
-    if(mSlidingOutPage) return;
+    // In continuous mode, the page number follows scrolling, which must not be reset:
+    if(mSlidingOutPage || mContinuous) return;
     setZoom(fitZoom());
     setPan(fitPan());
+
+    // The framebuffer still shows the previous page, which must not be previewed:
+    discardZoomPreview();
+    requestRenderWholePdf();
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -484,6 +885,7 @@ PdfViewer::setPageOrientation(
     if(mPageOrientation != orientation)
     {
         mPageOrientation = orientation;
+        updateLayout();
         emit pageOrientationChanged();
     }
 }
@@ -504,6 +906,7 @@ void PdfViewer::zoomIn(
         qreal const factor
 )
 {
+    beginInteraction();
     setZoom(zoom() * factor);
 }
 
@@ -511,6 +914,7 @@ void PdfViewer::zoomOut(
         qreal const factor
 )
 {
+    beginInteraction();
     setZoom(zoom() / factor);
 }
 
@@ -523,7 +927,10 @@ PdfViewer::mousePressEvent(
         QGraphicsSceneMouseEvent * const
 )
 {
-    // Simply grab mouse focus
+    // Grab mouse focus, catching the page if it is still moving from a flick:
+    mKineticAnimation->stop();
+    mDragVelocity = QPointF();
+    mDragTimer.start();
 }
 
 void
@@ -531,7 +938,15 @@ PdfViewer::mouseReleaseEvent(
         QGraphicsSceneMouseEvent * const
 )
 {
-    // Release mouse focus
+    // Release mouse focus. The page keeps moving if it has been let go while still being dragged,
+    // rather than after the pointer has come to rest:
+    bool const flicked = mDragTimer.isValid() && mDragTimer.elapsed() < FLICK_RELEASE_INTERVAL;
+    mDragTimer.invalidate();
+    if(mKineticScrolling && flicked && (mZoom > 1.0 || mContinuous) && !mSlidingOutPage
+            && qMax(qAbs(mDragVelocity.x()), qAbs(mDragVelocity.y())) > KineticAnimation::MIN_VELOCITY)
+    {
+        mKineticAnimation->fling(mDragVelocity);
+    }
 }
 
 void
@@ -544,20 +959,29 @@ PdfViewer::mouseMoveEvent(
         // Page slide animation is running:
         return;
     }
+    beginInteraction();
 
     int const dx = qRound(event->pos().x() - event->lastPos().x());
     int const dy = qRound(event->pos().y() - event->lastPos().y());
 
     // If zoom is not at fit level, movement means panning:
-    if(mZoom > 1.0) {
+    if(mZoom > 1.0 || mContinuous) {
         setPan(pan() + QPoint(dx, dy));
+
+        // Smoothed velocity of the drag, as single mouse moves are rather jittery:
+        qint64 const dt = mDragTimer.isValid() ? mDragTimer.restart() : 0;
+        if(dt > 0)
+        {
+            mDragVelocity = mDragVelocity * 0.2 + QPointF(dx, dy) / dt * 0.8;
+        }
+        prefetchAhead(mDragVelocity);
     }
 
     // If zoom is at fit level, horizontal movement beyond a certain
     // threshold value will trigger a page slide animation, given that
     // the document has any remaining pages in that direction:
     else if(
-            (dx < 0 && pageNumber() < mDocument->numPages() - 1) // User pulls to left, and there are following pages
+            (dx < 0 && pageNumber() < mDocument->pageCount() - 1) // User pulls to left, and there are following pages
             || (dx > 0 && pageNumber() > 0))                     // User pulls to right, and there are preceeding pages
     {
         // dx negative => next page
@@ -567,149 +991,421 @@ PdfViewer::mouseMoveEvent(
         mSlidingPull += dx;
         if(std::abs(mSlidingPull) > SLIDE_PULL_THRESHOLD) {
 
-            // Pre-render the whole page:
-            mSlidingImage = mPage->renderToImage(
-                        72.0 * computeScale(),
-                        72.0 * computeScale(),
-                        0,
-                        0,
-                        scaledPageQuad().width(),
-                        scaledPageQuad().height(),
-                        static_cast<Poppler::Page::Rotation>(pageOrientation()));
+            // At fit zoom the whole page is visible, so grab it from the framebuffer instead of rasterizing it again:
+            mSlidingImage = mFramebuffer.copy(QRect(fitPan(), scaledPageQuad()));
 
             // Setup animation curve, which will move the current page out at an increasing velocity:
+            Polynomial curve(3);
             if(mSlidingPull < 0)
             {
                 // Animate slide to next page, so the current page will move leftwards.
                 // The curve will start its animation at the fit-pan, not at 0, which would be the left viewport edge,
                 // and end when the complete page is hidden left of the left viewport edge:
-                mSlidingPolynomial.set(0, fitPan().x(), SLIDE_ANIMATION_DURATION, -scaledPageQuad().width());
+                curve.set(0, fitPan().x(), SLIDE_ANIMATION_DURATION, -scaledPageQuad().width());
             }
             else
             {
                 // Animate slide to previous page, so the current page will move rightwards.
                 // The curve will start its animation at the fit-pan, not at 0, which would be the left viewport edge,
                 // and end when the complete page is hidden right of the right viewport edge:
-                mSlidingPolynomial.set(0, fitPan().x(), SLIDE_ANIMATION_DURATION, viewport().width());
+                curve.set(0, fitPan().x(), SLIDE_ANIMATION_DURATION, viewport().width());
             }
 
             mSlidingOutPage = true;
             mSlidingInPage = false;
-            mSlidingTStart = QTime::currentTime();
-            startTimer(10);
+            mSlidingOffset = fitPan().x();
+            startSlide(curve);
         }
     }
 }
 
 void
-PdfViewer::timerEvent(QTimerEvent *event)
+PdfViewer::startSlide(
+        Polynomial const &curve
+)
 {
-    // The time since the animation started, corresponds to the x value of the animation polynomial:
-    int t = mSlidingTStart.msecsTo(QTime::currentTime());
-
-    // How much the page is shifted at the current time:
-    int shift = static_cast<int>(mSlidingPolynomial(t));
+    beginInteraction();
+    mSlideAnimation->setCurve(curve, static_cast<int>(SLIDE_ANIMATION_DURATION));
+    mSlidingFrameTime = RenderStats::now();
+    mSlideAnimation->start();
+}
 
-    // Paint the pre-rendered page at the current shift position:
-    QPainter painter(&mFramebuffer);
-    painter.fillRect(0, 0, mFramebuffer.width(), mFramebuffer.height(), mBackgroundColor);
-    painter.drawImage(shift, fitPan().y(), mSlidingImage);
-    update();
+void
+PdfViewer::showSlideFrame(
+        int const offset
+)
+{
+    // Frames arriving late, e.g. because of a long paint, make the animation stutter:
+    qint64 const frameTime = RenderStats::now();
+    mStats->addAnimationFrame(frameTime - mSlidingFrameTime, SlideAnimation::FRAME_INTERVAL * 1000);
+    mSlidingFrameTime = frameTime;
 
-    if(t > SLIDE_ANIMATION_DURATION)
+    if(offset == mSlidingOffset)
     {
-        // Animation finished, stop timer:
-        killTimer(event->timerId());
-
-        if(mSlidingInPage) {
-            // This was the animation for the next/previous page to slide in, so stop the whole sliding state:
-            mSlidingOutPage = false;
-            mSlidingInPage = false;
-            mSlidingPull = 0;
-            return;
-        }
+        return;
+    }
 
-        // Otherwise, start to slide in the next/previous page:
-        if(mSlidingPull < 0) {
-            // Go to next page (implicitly guarenteed that there is one, otherwise the slide animation would
-            // not start at all. This time, the curve is flipped, so the start point is steep and the end
-            // is the curve extrem-point.
-            setPageNumber(pageNumber() + 1);
-            mSlidingPolynomial.set(SLIDE_ANIMATION_DURATION, fitPan().x(), 0, viewport().width());
-        }
-        else {
-            setPageNumber(pageNumber() - 1);
-            mSlidingPolynomial.set(SLIDE_ANIMATION_DURATION, fitPan().x(), 0, -scaledPageQuad().width());
-        }
+    // Only the area covered by the page before and after the move has changed, everything else is background anyway:
+    QRect const previousRect(QPoint(mSlidingOffset, fitPan().y()), scaledPageQuad());
+    mSlidingOffset = offset;
+    QRect const currentRect(QPoint(mSlidingOffset, fitPan().y()), scaledPageQuad());
+    update((previousRect | currentRect) & QRect(QPoint(0, 0), viewport()));
+}
 
-        mSlidingImage = mPage->renderToImage(
-                    72.0 * computeScale(),
-                    72.0 * computeScale(),
-                    0,
-                    0,
-                    scaledPageQuad().width(),
-                    scaledPageQuad().height(),
-                    static_cast<Poppler::Page::Rotation>(pageOrientation()));
+void
+PdfViewer::finishSlide()
+{
+    if(mSlidingInPage) {
+        // This was the animation for the next/previous page to slide in, so stop the whole sliding state:
+        mSlidingOutPage = false;
+        mSlidingInPage = false;
+        mSlidingImagePending = false;
+        mSlidingPull = 0;
+
+        // Slides are painted straight from the sliding image, so the framebuffer is brought up to date only now.
+        // The page is usually found in the tile cache, as it has been sliding in from there:
+        requestRenderWholePdf();
+        return;
+    }
 
-        mSlidingTStart = QTime::currentTime();
-        mSlidingInPage = true;
+    // Otherwise, start to slide in the next/previous page:
+    Polynomial curve(3);
+    if(mSlidingPull < 0) {
+        // Go to next page (implicitly guarenteed that there is one, otherwise the slide animation would
+        // not start at all. This time, the curve is flipped, so the start point is steep and the end
+        // is the curve extrem-point.
+        setPageNumber(pageNumber() + 1);
+        curve.set(SLIDE_ANIMATION_DURATION, fitPan().x(), 0, viewport().width());
+    }
+    else {
+        setPageNumber(pageNumber() - 1);
+        curve.set(SLIDE_ANIMATION_DURATION, fitPan().x(), 0, -scaledPageQuad().width());
+    }
 
-        // Start timer again, to slide in page
-        startTimer(10);
+    // Slide in the prefetched page, or a blank page until the render pool delivers the real one.
+    // Pages beyond the pixel cap slide in downsampled, their tiles are rendered once the slide has finished:
+    mSlidingImage = cachedWholePage(mPageNumber, computeScale());
+    mSlidingImagePending = mSlidingImage.isNull();
+    if(mSlidingImagePending)
+    {
+        requestWholePage(mPageNumber, computeScale(), renderHints(mPageNumber), RenderJob::INTERACTIVE);
     }
+
+    mSlidingInPage = true;
+    mSlidingOffset = static_cast<int>(curve(0));
+    startSlide(curve);
 }
 
 void
-PdfViewer::mouseDoubleClickEvent(
-        QGraphicsSceneMouseEvent * const
+PdfViewer::kineticStep(
+        QPoint const &delta
 )
 {
-    if(equalReals(zoom(), fitZoom()))
-    {
-        // Zoom to cover:
-        setZoom(coverZoom());
-        setPan(coverPan());
-    }
-    else
+    beginInteraction();
+
+    // Stop at the edges, rather than pushing against them until the velocity has decayed:
+    QPoint const previousPan = pan();
+    setPan(pan() + delta);
+    if(pan() == previousPan)
     {
-        // Zoom to fit:
-        setZoom(fitZoom());
-        setPan(fitPan());
+        mKineticAnimation->stop();
+        return;
     }
+    prefetchAhead(mKineticAnimation->velocity());
 }
 
-/////////////////////////////////////////////////////////////////////////////////////////////////////////
-/////////////////////        Helper functions
-/////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool
+PdfViewer::kineticScrolling() const
+{
+    return mKineticScrolling;
+}
 
-QSize
-PdfViewer::pageQuad() const
+void
+PdfViewer::setKineticScrolling(
+        bool const kineticScrolling
+)
 {
-    if(!mPage)
+    if(kineticScrolling != mKineticScrolling)
     {
-        return viewport();
+        mKineticScrolling = kineticScrolling;
+        mKineticAnimation->stop();
+        emit kineticScrollingChanged();
     }
-    return (mPageOrientation == ZERO_PI) || (mPageOrientation == ONE_PI)
-            ? mPage->pageSize() // Take page size as is.
-            : QSize(mPage->pageSize().height(), mPage->pageSize().width()); // Swap the page's width and height.
 }
 
-qreal
-PdfViewer::computeScale() const
+PdfViewer::InteractionQuality
+PdfViewer::interactionQuality() const
 {
-    return zoom() * fitScale(); // Remember, a zoom of 1 *is defined* as the fit scale.
+    return mInteractionQuality;
 }
 
-qreal
-PdfViewer::fitScale() const
+void
+PdfViewer::setInteractionQuality(
+        InteractionQuality const interactionQuality
+)
 {
-    if(!mPage)
+    if(interactionQuality != mInteractionQuality)
     {
-        return 1;
+        mInteractionQuality = interactionQuality;
+        emit interactionQualityChanged();
     }
+}
+
+int
+PdfViewer::refinementDelay() const
+{
+    return mRefinementTimer->interval();
+}
+
+void
+PdfViewer::setRefinementDelay(
+        int refinementDelay
+)
+{
+    refinementDelay = qMax(0, refinementDelay);
+    if(refinementDelay != mRefinementTimer->interval())
+    {
+        mRefinementTimer->setInterval(refinementDelay);
+        emit refinementDelayChanged();
+    }
+}
+
+bool
+PdfViewer::interacting() const
+{
+    return mInteracting;
+}
+
+void
+PdfViewer::beginInteraction()
+{
+    // Every input event extends the interaction, it ends once the view has been left alone for the refinement delay:
+    mRefinementTimer->start();
+    if(!mInteracting)
+    {
+        mInteracting = true;
+        emit interactingChanged();
+    }
+}
+
+void
+PdfViewer::refine()
+{
+    // A slide is painted from a single image, the framebuffer is only rendered again once it has finished:
+    if(mSlidingOutPage)
+    {
+        mRefinementTimer->start();
+        return;
+    }
+
+    // Whatever has been rendered fast is still on screen, so it is kept until replaced by the full quality tiles:
+    int firstPage;
+    int lastPage;
+    visiblePages(QRect(QPoint(0, 0), viewport()), firstPage, lastPage);
+    qreal interactionScale = computeScale();
+    for(int pageNumber = qMax(0, firstPage); pageNumber <= lastPage; pageNumber++)
+    {
+        interactionScale = qMin(interactionScale, renderScale(pageNumber));
+    }
+    mInteracting = false;
+    emit interactingChanged();
+    if(mRefinementPending)
+    {
+        mRefinementPending = false;
+        mKeepStaleContent = true;
+        mStaleContentScale = qMax(mStaleContentScale, interactionScale);
+        requestRenderWholePdf();
+    }
+}
+
+void
+PdfViewer::mouseDoubleClickEvent(
+        QGraphicsSceneMouseEvent * const
+)
+{
+    beginInteraction();
+    if(equalReals(zoom(), fitZoom()))
+    {
+        // Zoom to cover:
+        setZoom(coverZoom());
+        setPan(coverPan());
+    }
+    else
+    {
+        // Zoom to fit:
+        setZoom(fitZoom());
+        setPan(fitPan());
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////////////////////        Text search
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+qreal
+PdfViewer::textIndexProgress() const
+{
+    TextIndex const * const index = mDocument && mStatus == OK ? mDocument->textIndex() : Q_NULLPTR;
+    return index ? static_cast<qreal>(index->indexedPageCount()) / mDocument->pageCount() : 0;
+}
+
+QVariantList
+PdfViewer::search(
+        QString const &text
+)
+{
+    QVariantList result;
+    if(!mDocument || OK != mStatus)
+    {
+        return result;
+    }
+
+    // Text is only indexed once the user first searches, so opening a document does not compete with its first paint.
+    // Hits on further pages follow along with textIndexProgressChanged():
+    mDocument->startTextIndex();
+    TextIndex const * const index = mDocument->textIndex();
+    if(!index)
+    {
+        return result;
+    }
+
+    QList<TextIndex::Hit> const hits = index->search(text, MAX_SEARCH_HITS);
+    for(int i = 0; i < hits.size(); i++)
+    {
+        QVariantList rects;
+        for(int j = 0; j < hits.at(i).boxes.size(); j++)
+        {
+            rects.append(hits.at(i).boxes.at(j));
+        }
+
+        QVariantMap hit;
+        hit.insert("pageNumber", hits.at(i).pageNumber);
+        hit.insert("rects", rects);
+        result.append(hit);
+    }
+    return result;
+}
+
+QRectF
+PdfViewer::mapFromPage(
+        int pageNumber,
+        QRectF const &rect
+) const
+{
+    if(!mDocument || pageNumber < 0 || pageNumber >= mDocument->pageCount())
+    {
+        return QRectF();
+    }
+
+    // Rotate like Poppler does when rendering, i.e. clockwise in steps of π/2:
+    QSizeF const size = mDocument->pageSize(pageNumber);
+    QRectF rotated;
+    switch(mPageOrientation)
+    {
+    case HALF_PI:
+        rotated = QRectF(size.height() - rect.bottom(), rect.left(), rect.height(), rect.width());
+        break;
+
+    case ONE_PI:
+        rotated = QRectF(size.width() - rect.right(), size.height() - rect.bottom(), rect.width(), rect.height());
+        break;
+
+    case ONE_HALF_PI:
+        rotated = QRectF(rect.top(), size.width() - rect.right(), rect.height(), rect.width());
+        break;
+
+    default:
+        rotated = rect;
+        break;
+    }
+
+    // Then place it like the page itself:
+    qreal const scale = computeScale();
+    QPointF const translation = pan() + zoomPan() + pageOrigin(pageNumber);
+    return QRectF(rotated.topLeft() * scale + translation, rotated.size() * scale);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////////////////////        Render costs
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+qreal
+PdfViewer::pageRenderTime(
+        int pageNumber
+) const
+{
+    return mDocument ? mDocument->pageRenderTime(pageNumber) : 0;
+}
+
+qreal
+PdfViewer::pageRenderCost(
+        int pageNumber
+) const
+{
+    return mDocument ? mDocument->pageRenderCost(pageNumber) : -1;
+}
+
+void
+PdfViewer::updatePageRenderCost(
+        int const pageNumber
+)
+{
+    // The tiers of the pages are kept while interacting, as tiles already requested for the previous tier would not fit anymore:
+    if(!mInteracting)
+    {
+        if(isExpensiveCost(mDocument->pageRenderCost(pageNumber)))
+        {
+            mExpensivePages.insert(pageNumber);
+        }
+        else
+        {
+            mExpensivePages.remove(pageNumber);
+        }
+    }
+    emit pageRenderCostChanged(pageNumber);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////////////////////        Helper functions
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+QSize
+PdfViewer::pageQuad(
+        int const pageNumber
+) const
+{
+    // Page sizes have been read once when opening the document:
+    QSize const size = mDocument->pageSize(pageNumber);
+    return (mPageOrientation == ZERO_PI) || (mPageOrientation == ONE_PI)
+            ? size
+            : QSize(size.height(), size.width());
+}
+
+QSize
+PdfViewer::pageQuad() const
+{
+    return viewTransform().pageQuad;
+}
+
+qreal
+PdfViewer::computeScale() const
+{
+    return viewTransform().scale;
+}
+
+qreal
+PdfViewer::fitScale() const
+{
+    return viewTransform().fitScale;
+}
 
-    qreal const pageWidth = pageQuad().width();
-    qreal const pageHeight = pageQuad().height();
+qreal
+PdfViewer::fitScale(
+        QSize const &pageQuad
+) const
+{
+    qreal const pageWidth = pageQuad.width();
+    qreal const pageHeight = pageQuad.height();
     qreal const pageAspectRatio = pageWidth / pageHeight;
 
     if(width() > height() * pageAspectRatio)
@@ -725,23 +1421,177 @@ PdfViewer::fitScale() const
 qreal
 PdfViewer::coverScale() const
 {
-    if(!mPage)
+    return viewTransform().coverScale;
+}
+
+PdfViewer::ViewTransform const &
+PdfViewer::viewTransform() const
+{
+    if(mViewTransformValid)
     {
-        return 1;
+        return mViewTransform;
     }
 
-    qreal const pageWidth = pageQuad().width();
-    qreal const pageHeight = pageQuad().height();
-    qreal const pageAspectRatio = pageWidth / pageHeight;
+    ViewTransform &t = mViewTransform;
+    if(mContinuous && !mPageOffsets.isEmpty())
+    {
+        // All pages share a common scale, at which the widest page fits the viewport width:
+        t.pageQuad = QSize(qCeil(mLayoutWidth), qCeil(mPageOffsets.last()));
+        t.fitScale = width() / mLayoutWidth;
+        t.coverScale = t.fitScale;
+        t.scale = zoom() * t.fitScale;
+        t.scaledPageQuad = QSize(t.pageQuad.width(), t.pageQuad.height()) * t.scale;
+
+        // Zoom is anchored at the viewport center by setZoom(), so neither zoom nor fit move the layout:
+        t.zoomPan = QPoint(0, 0);
+        t.fitPan = QPoint(0, 0);
+        t.coverPan = QPoint(0, 0);
+
+        mViewTransformValid = true;
+        return t;
+    }
 
-    if(width() > height() * pageAspectRatio)
+    if(mPageNumber < 0)
     {
-        return width() / pageWidth;
+        // Without a page, the viewport is shown as is:
+        t.pageQuad = viewport();
+        t.fitScale = 1;
+        t.coverScale = 1;
     }
     else
     {
-        return height() / pageHeight;
+        t.pageQuad = pageQuad(mPageNumber);
+
+        qreal const pageWidth = t.pageQuad.width();
+        qreal const pageHeight = t.pageQuad.height();
+        qreal const pageAspectRatio = pageWidth / pageHeight;
+
+        if(width() > height() * pageAspectRatio)
+        {
+            t.fitScale = height() / pageHeight;
+            t.coverScale = width() / pageWidth;
+        }
+        else
+        {
+            t.fitScale = width() / pageWidth;
+            t.coverScale = height() / pageHeight;
+        }
+    }
+
+    t.scale = zoom() * t.fitScale; // Remember, a zoom of 1 *is defined* as the fit scale.
+    t.scaledPageQuad = QSize(t.pageQuad.width(), t.pageQuad.height()) * t.scale;
+    t.zoomPan = -QPoint(t.pageQuad.width(), t.pageQuad.height()) * (t.scale - t.fitScale) / 2;
+    t.fitPan = QPoint(
+                qRound(viewport().width() - t.pageQuad.width() * t.fitScale) / 2,
+                qRound(viewport().height() - t.pageQuad.height() * t.fitScale) / 2);
+    t.coverPan = QPoint(
+                (qRound(t.pageQuad.width() * (t.coverScale - t.fitScale))) / 2,
+                (qRound(t.pageQuad.height() * (t.coverScale - t.fitScale))) / 2);
+
+    mViewTransformValid = true;
+    return t;
+}
+
+void
+PdfViewer::invalidateViewTransform()
+{
+    mViewTransformValid = false;
+}
+
+void
+PdfViewer::updateLayout()
+{
+    mPageOffsets.clear();
+    mLayoutWidth = 0;
+    invalidateViewTransform();
+
+    // Documents which cannot be shown have no pages to lay out:
+    if(!mContinuous || !mDocument || 0 == mDocument->pageCount())
+    {
+        return;
+    }
+
+    // Prefix sums over the page heights, the last entry being the height of the whole layout.
+    // Thereby the page at any position is found by a binary search:
+    mPageOffsets.reserve(mDocument->pageCount() + 1);
+    qreal offset = 0;
+    for(int i = 0; i < mDocument->pageCount(); i++)
+    {
+        QSize const quad = pageQuad(i);
+        mPageOffsets.append(offset);
+        offset += quad.height() + PAGE_SPACING;
+        mLayoutWidth = qMax(mLayoutWidth, static_cast<qreal>(quad.width()));
+    }
+    mPageOffsets.append(offset - PAGE_SPACING);
+}
+
+int
+PdfViewer::pageAt(
+        qreal const y
+) const
+{
+    if(mPageOffsets.size() < 2)
+    {
+        return qMax(0, mPageNumber);
+    }
+
+    // The last page whose top is above the position, spacing counts to the page above:
+    QVector<qreal>::const_iterator const pageEnd = mPageOffsets.constEnd() - 1;
+    int const pageNumber = qUpperBound(mPageOffsets.constBegin(), pageEnd, y) - mPageOffsets.constBegin() - 1;
+    return qBound(0, pageNumber, mPageOffsets.size() - 2);
+}
+
+QPoint
+PdfViewer::pageOrigin(
+        int const pageNumber
+) const
+{
+    if(!mContinuous || mPageOffsets.isEmpty())
+    {
+        return QPoint(0, 0);
+    }
+
+    // Pages are centered horizontally within the layout:
+    qreal const scale = computeScale();
+    return QPoint(
+                qRound((mLayoutWidth - pageQuad(pageNumber).width()) * scale / 2),
+                qRound(mPageOffsets.at(pageNumber) * scale));
+}
+
+void
+PdfViewer::visiblePages(
+        QRect const &viewportSpaceRect,
+        int &first,
+        int &last
+) const
+{
+    if(!mContinuous)
+    {
+        first = mPageNumber;
+        last = mPageNumber;
+        return;
+    }
+    if(mPageOffsets.isEmpty())
+    {
+        first = 0;
+        last = -1;
+        return;
     }
+
+    qreal const top = pan().y() + zoomPan().y();
+    first = pageAt((viewportSpaceRect.top() - top) / computeScale());
+    last = pageAt((viewportSpaceRect.bottom() - top) / computeScale());
+}
+
+void
+PdfViewer::geometryChanged(
+        QRectF const &newGeometry,
+        QRectF const &oldGeometry
+)
+{
+    // Invalidate before the base class announces the new width and height:
+    invalidateViewTransform();
+    QDeclarativeItem::geometryChanged(newGeometry, oldGeometry);
 }
 
 bool
@@ -762,47 +1612,57 @@ void
 PdfViewer::requestRenderWholePdf()
 {
     if(mSlidingOutPage) return;
+    cancelObsoleteJobs();
     mRenderRegion = QRect(0, 0, viewport().width(), viewport().height());
+    if(!mKeepStaleContent)
+    {
+        mStaleContentScale = 0;
+    }
+    mPrefetchTimer->start();
+    updateBusy();
+    update();
+}
+
+void
+PdfViewer::scheduleFramebufferResize()
+{
     update();
 }
 
 void
 PdfViewer::allocateFramebuffer()
 {
-    if(mFramebuffer.isNull())
+    QSize const size = viewport();
+    if(size == mFramebuffer.size())
     {
-        // No framebuffer has been allocated yet, so do that now:
-        mFramebuffer = QPixmap(viewport().width(), viewport().height());
+        return;
+    }
+
+    QRect const viewportRect(QPoint(0, 0), size);
+    if(!mFramebuffer.isNull() && equalReals(mFramebufferScale, computeScale()))
+    {
+        // The page is still shown at the same scale, so the overlapping pixels remain valid,
+        // any scrolling caused by the resize has already been applied to the old framebuffer.
+        // Only the newly exposed area needs to be rendered:
+        mRenderRegion += QRegion(viewportRect) - QRegion(mFramebuffer.rect());
+        mRenderRegion &= viewportRect;
     }
     else
     {
-        // Resize the current framebuffer instead of creating a new one:
-        mFramebuffer = mFramebuffer.scaled(viewport().width(), viewport().height());
+        mRenderRegion = viewportRect;
     }
-}
 
-QPoint PdfViewer::zoomPan() const
-{
-    return -QPoint(pageQuad().width(),pageQuad().height()) * (computeScale() - fitScale()) / 2;
+    mFramebuffer.resize(size, mBackgroundColor);
 }
 
-QRect
-PdfViewer::visiblePdfRect(
-        QRect const viewportSpaceClip
-) const
+QPoint PdfViewer::zoomPan() const
 {
-    // This rect is equally in size as the final Pdf which would appear on screen:
-    QRect const pdfRect(0, 0, scaledPageQuad().width(), scaledPageQuad().height());
-
-    // Transform mapping the document onto it's position on screen:
-    QPoint const translation = pan() + zoomPan();
-
-    // Now figure out which rect a currently visible to the user by inverting that transform matrix:
-    return viewportSpaceClip.translated(-translation) & pdfRect;
+    return viewTransform().zoomPan;
 }
 
 void PdfViewer::renderPdfIntoFramebuffer(
-        QRect const viewportSpaceRect
+        QRect const viewportSpaceRect,
+        bool const keepStaleContent
 )
 {
     // If no page is set currently, or no framebuffer is allocated yet, skip:
@@ -811,50 +1671,866 @@ void PdfViewer::renderPdfIntoFramebuffer(
         return;
     }
 
-    QRect const visiblePdf = visiblePdfRect(viewportSpaceRect);
-
-    QPainter painter(&mFramebuffer);
-    painter.setPen(Qt::transparent);
-    painter.setBrush(backgroundColor());
-    painter.drawRect(viewportSpaceRect);
-
-    // Painter should start drawing the image at the current clipped visible rect position:
-    painter.translate(pan() + zoomPan() + visiblePdf.topLeft());
+    // Only the pages intersecting the area are rendered, which is a single one unless in continuous mode:
+    int firstPage;
+    int lastPage;
+    visiblePages(viewportSpaceRect, firstPage, lastPage);
+    QPoint const translation = pan() + zoomPan();
 
-    if(!mPage)
+    // Clear the area, tiles which are not cached yet get filled as soon as the render pool has finished them.
+    // Stale content may be kept on the pages until then, so only the space around them needs to be cleared:
+    QRegion clearRegion(viewportSpaceRect);
+    for(int pageNumber = qMax(0, firstPage); keepStaleContent && pageNumber <= lastPage; pageNumber++)
     {
-        return;
+        clearRegion -= QRect(translation + pageOrigin(pageNumber), pageQuad(pageNumber) * computeScale());
+    }
+    for(int i = 0; i < clearRegion.rectCount(); i++)
+    {
+        mFramebuffer.fill(clearRegion.rects()[i], backgroundColor());
     }
 
-    QImage const image = mPage->renderToImage(
-                72.0 * computeScale(),
-                72.0 * computeScale(),
-                visiblePdf.x(),
-                visiblePdf.y(),
-                visiblePdf.width(),
-                visiblePdf.height(),
-                static_cast<Poppler::Page::Rotation>(pageOrientation()));
+    for(int pageNumber = qMax(0, firstPage); pageNumber <= lastPage; pageNumber++)
+    {
+        renderPageIntoFramebuffer(pageNumber, viewportSpaceRect, keepStaleContent);
 
-    painter.drawImage(0, 0, image);
+        // Content rendered fast is rendered again at full quality once the interaction has ended:
+        if(renderHints(pageNumber) != qualityRenderHints() || !equalReals(renderScale(pageNumber), computeScale()))
+        {
+            mRefinementPending = true;
+        }
+    }
 }
 
 void
-PdfViewer::paint(
-        QPainter * const painter,
-        QStyleOptionGraphicsItem const * const,
-        QWidget * const
+PdfViewer::renderPageIntoFramebuffer(
+        int const pageNumber,
+        QRect const &viewportSpaceRect,
+        bool const keepStaleContent
 )
 {
-    if(!mSlidingOutPage) {
-        for(int i = 0; i < mRenderRegion.rectCount(); i++)
-        {
-            renderPdfIntoFramebuffer(mRenderRegion.rects()[i]);
-        }
+    // Transform mapping the page onto its position on screen:
+    QPoint const translation = pan() + zoomPan() + pageOrigin(pageNumber);
+
+    // This rect is equally in size as the final page which would appear on screen,
+    // the part currently visible to the user is found by inverting the transform:
+    QRect const pageRect(QPoint(0, 0), pageQuad(pageNumber) * computeScale());
+    QRect const visiblePdf = viewportSpaceRect.translated(-translation) & pageRect;
+    if(visiblePdf.isEmpty())
+    {
+        return;
+    }
+
+    // The page might have been prefetched as a whole, unless it is beyond the pixel cap and only cached downsampled:
+    QImage const wholePage = cachedWholePage(pageNumber, computeScale());
+    if(!wholePage.isNull() && wholePage.size() == pageRect.size())
+    {
+        mStats->addCacheLookup(true);
+        mFramebuffer.blit(translation + visiblePdf.topLeft(), wholePage, visiblePdf);
+        return;
     }
+
+    // While interacting, tiles may be rendered at a reduced resolution and are stretched to the current scale:
+    qreal const scale = renderScale(pageNumber);
+    qreal const factor = computeScale() / scale;
+    QRect const renderPageRect(QPoint(0, 0), pageQuad(pageNumber) * scale);
+    QRect const renderVisiblePdf = QRectF(QPointF(visiblePdf.topLeft()) / factor, QSizeF(visiblePdf.size()) / factor).toAlignedRect() & renderPageRect;
+
+    // Tiles rendered at full quality are as good as fast ones while interacting:
+    bool const qualityTilesUsable = equalReals(scale, computeScale()) && renderHints(pageNumber) != qualityRenderHints();
+
+    // Compose the visible area from the tile grid, only missing tiles are rendered:
+    int const lastColumn = renderVisiblePdf.right() / TileCache::TILE_SIZE;
+    int const lastRow = renderVisiblePdf.bottom() / TileCache::TILE_SIZE;
+    bool missingTiles = false;
+    QImage level;
+    qreal levelScale = 0;
+    for(int row = renderVisiblePdf.top() / TileCache::TILE_SIZE; row <= lastRow; row++)
+    {
+        for(int column = renderVisiblePdf.left() / TileCache::TILE_SIZE; column <= lastColumn; column++)
+        {
+            TileKey const key(pageNumber, scale, pageOrientation(), renderHints(pageNumber), column, row);
+            QRect const tileRect = TileCache::tileRect(column, row, renderPageRect);
+            QRect const part = tileRect & renderVisiblePdf;
+            QRectF const target(QPointF(translation) + QPointF(part.topLeft()) * factor, QSizeF(part.size()) * factor);
+            QImage tile;
+            if(qualityTilesUsable)
+            {
+                tile = mDocument->tileCache().tile(TileKey(pageNumber, scale, pageOrientation(), qualityRenderHints(), column, row));
+            }
+            if(tile.isNull())
+            {
+                tile = mDocument->tileCache().tile(key);
+            }
+            mStats->addCacheLookup(!tile.isNull());
+            if(tile.isNull())
+            {
+                requestTile(key, tileRect);
+
+                // The nearest cached level stands in until the tile arrives, unless the stale content is sharper:
+                if(!missingTiles)
+                {
+                    missingTiles = true;
+                    level = levelOfDetail(pageNumber, levelScale);
+                }
+                QRectF levelTarget;
+                QRectF levelSource;
+                if(!level.isNull() && (!keepStaleContent || levelScale > mStaleContentScale)
+                        && levelOfDetailRects(pageNumber, target.toAlignedRect(), levelScale, levelTarget, levelSource))
+                {
+                    mFramebuffer.draw(levelTarget, level, levelSource);
+                }
+                continue;
+            }
+
+            // Only blit the part of the tile that has been requested:
+            if(equalReals(factor, 1))
+            {
+                mFramebuffer.blit(translation + part.topLeft(), tile, part.translated(-tileRect.topLeft()));
+            }
+            else
+            {
+                mFramebuffer.draw(target, tile, QRectF(part.translated(-tileRect.topLeft())));
+            }
+        }
+    }
+
+    // A page shown at a new scale is added to the pyramid, so coming back to a similar zoom is immediate.
+    // Levels coinciding with the current scale are not needed, the tiles serve that scale already:
+    qreal const nearestLevelScale = this->levelScale(pageNumber);
+    if(missingTiles
+            && !equalReals(nearestLevelScale, computeScale())
+            && mDocument->tileCache().tile(TileKey::wholePage(pageNumber, nearestLevelScale, pageOrientation(), qualityRenderHints())).isNull())
+    {
+        requestWholePage(pageNumber, nearestLevelScale, qualityRenderHints(), RenderJob::BACKGROUND);
+    }
+}
+
+qreal
+PdfViewer::levelScale(
+        int const pageNumber
+) const
+{
+    // The power of two just below the current scale, as long as the page image stays within the pixel cap:
+    int exponent = qBound(MIN_LEVEL, qFloor(qLn(computeScale()) / qLn(2.0)), MAX_LEVEL);
+    QSize const quad = pageQuad(pageNumber);
+    while(exponent > MIN_LEVEL
+          && static_cast<qint64>(quad.width() * qPow(2.0, exponent)) * static_cast<qint64>(quad.height() * qPow(2.0, exponent)) > MAX_LEVEL_PIXELS)
+    {
+        exponent--;
+    }
+    return qPow(2.0, exponent);
+}
+
+QImage
+PdfViewer::levelOfDetail(
+        int const pageNumber,
+        qreal &levelScale
+) const
+{
+    // Levels are always rendered at full quality, so they are shared by all interaction states.
+    // The coarsest level at least as sharp as the current scale is preferred, otherwise the finest coarser one:
+    int const sharpExponent = qBound(MIN_LEVEL, qCeil(qLn(computeScale()) / qLn(2.0)), MAX_LEVEL + 1);
+    for(int exponent = sharpExponent; exponent <= MAX_LEVEL; exponent++)
+    {
+        levelScale = qPow(2.0, exponent);
+        QImage const level = mDocument->tileCache().tile(TileKey::wholePage(pageNumber, levelScale, pageOrientation(), qualityRenderHints()));
+        if(!level.isNull())
+        {
+            return level;
+        }
+    }
+    for(int exponent = sharpExponent - 1; exponent >= MIN_LEVEL; exponent--)
+    {
+        levelScale = qPow(2.0, exponent);
+        QImage const level = mDocument->tileCache().tile(TileKey::wholePage(pageNumber, levelScale, pageOrientation(), qualityRenderHints()));
+        if(!level.isNull())
+        {
+            return level;
+        }
+    }
+
+    levelScale = 0;
+    return QImage();
+}
+
+bool
+PdfViewer::levelOfDetailRects(
+        int const pageNumber,
+        QRect const &viewportSpaceRect,
+        qreal const levelScale,
+        QRectF &target,
+        QRectF &source
+) const
+{
+    QPoint const translation = pan() + zoomPan() + pageOrigin(pageNumber);
+    QRect const pageRect(QPoint(0, 0), pageQuad(pageNumber) * computeScale());
+    QRect const part = viewportSpaceRect.translated(-translation) & pageRect;
+    if(part.isEmpty())
+    {
+        return false;
+    }
+
+    // The part of the page is found within the level by scaling it from the current scale to the level's one:
+    qreal const factor = levelScale / computeScale();
+    target = QRectF(part.translated(translation));
+    source = QRectF(QPointF(part.topLeft()) * factor, QSizeF(part.size()) * factor);
+    return true;
+}
+
+void
+PdfViewer::drawLevelIntoPendingTiles(
+        int const pageNumber
+)
+{
+    qreal levelScale;
+    QImage const level = levelOfDetail(pageNumber, levelScale);
+    if(level.isNull() || levelScale <= mStaleContentScale)
+    {
+        return;
+    }
+
+    QPoint const translation = pan() + zoomPan() + pageOrigin(pageNumber);
+    qreal const factor = computeScale() / renderScale(pageNumber);
+    QRect const renderPageRect(QPoint(0, 0), pageQuad(pageNumber) * renderScale(pageNumber));
+    TileKey const current(pageNumber, renderScale(pageNumber), pageOrientation(), renderHints(pageNumber), 0, 0);
+    for(QSet<TileKey>::const_iterator tile = mPendingTiles.constBegin(); tile != mPendingTiles.constEnd(); ++tile)
+    {
+        if(tile->pageNumber != pageNumber || tile->scale != current.scale || tile->orientation != current.orientation
+                || tile->renderHints != current.renderHints || tile->column < 0)
+        {
+            continue;
+        }
+
+        QRect const tileRect = TileCache::tileRect(tile->column, tile->row, renderPageRect);
+        QRect const tileTarget = QRectF(QPointF(translation) + QPointF(tileRect.topLeft()) * factor, QSizeF(tileRect.size()) * factor).toAlignedRect();
+        QRectF target;
+        QRectF source;
+        if(levelOfDetailRects(pageNumber, tileTarget, levelScale, target, source))
+        {
+            mFramebuffer.draw(target, level, source);
+            update(target);
+        }
+    }
+}
+
+void
+PdfViewer::cancelObsoleteJobs()
+{
+    // Every render of the whole view starts a new generation. Jobs of older ones are dropped unless already started,
+    // as Poppler cannot abort a rasterization. Tiles still needed are simply requested again:
+    mGeneration++;
+    mDeadlineTimer->stop();
+    if(mDocument)
+    {
+        mDocument->cancel(this, mGeneration);
+    }
+}
+
+void
+PdfViewer::dropCancelledJob(
+        RenderJob const &job
+)
+{
+    if(this == job.owner)
+    {
+        mStats->addCancelledJob();
+        mPendingTiles.remove(job.key);
+        updateBusy();
+        return;
+    }
+
+    // Another viewer has dropped a tile this viewer is waiting for as well, so it is requested on behalf of this one:
+    if(mPendingTiles.contains(job.key))
+    {
+        RenderJob own = job;
+        own.owner = this;
+        own.generation = mGeneration;
+        mDocument->render(own);
+    }
+}
+
+void
+PdfViewer::previewMissedDeadline()
+{
+    if(OK != mStatus || mFramebuffer.isNull() || mSlidingOutPage || !mZoomPreview.isNull())
+    {
+        return;
+    }
+
+    // Only visible tiles of the current view state are late, anything else is not awaited by the user:
+    int firstPage;
+    int lastPage;
+    visiblePages(QRect(QPoint(0, 0), viewport()), firstPage, lastPage);
+    QSet<int> latePages;
+    for(QSet<TileKey>::const_iterator tile = mPendingTiles.constBegin(); tile != mPendingTiles.constEnd(); ++tile)
+    {
+        if(tile->pageNumber < firstPage || tile->pageNumber > lastPage || tile->column < 0)
+        {
+            continue;
+        }
+        TileKey const current(tile->pageNumber, renderScale(tile->pageNumber), pageOrientation(), renderHints(tile->pageNumber), 0, 0);
+        if(tile->scale == current.scale && tile->orientation == current.orientation && tile->renderHints == current.renderHints)
+        {
+            latePages.insert(tile->pageNumber);
+        }
+    }
+    if(latePages.isEmpty())
+    {
+        return;
+    }
+    mStats->addMissedDeadline();
+
+    // Pages without any level of detail standing in get a coarse one ahead of all other jobs,
+    // which is drawn into their missing tiles as soon as it arrives:
+    for(QSet<int>::const_iterator page = latePages.constBegin(); page != latePages.constEnd(); ++page)
+    {
+        qreal levelScale;
+        if(!levelOfDetail(*page, levelScale).isNull())
+        {
+            continue;
+        }
+
+        // Expensive pages are previewed coarser, as long as the preview itself would miss the deadline by the page's measured cost.
+        // Every level coarser quarters the pixels:
+        QSize const quad = pageQuad(*page);
+        qreal const cost = mDocument->pageRenderCost(*page);
+        qreal previewScale = this->levelScale(*page) / qPow(2.0, PREVIEW_LEVEL_OFFSET);
+        while(previewScale > qPow(2.0, MIN_LEVEL)
+              && cost * quad.width() * previewScale * quad.height() * previewScale / 1000000.0 > RENDER_DEADLINE)
+        {
+            previewScale /= 2;
+        }
+        previewScale = qMax(previewScale, qPow(2.0, MIN_LEVEL));
+        if(previewScale < computeScale())
+        {
+            requestWholePage(*page, previewScale, qualityRenderHints(), RenderJob::PREVIEW);
+        }
+    }
+}
+
+void
+PdfViewer::requestTile(
+        TileKey const &key,
+        QRect const &tileRect,
+        RenderJob::Priority const priority
+)
+{
+    // The tile might already be on its way:
+    if(mPendingTiles.contains(key))
+    {
+        return;
+    }
+    mPendingTiles.insert(key);
+
+    RenderJob job;
+    job.key = key;
+    job.pageNumber = key.pageNumber;
+    job.scale = renderScale(key.pageNumber);
+    job.orientation = key.orientation;
+    job.rect = tileRect;
+    job.priority = priority;
+    job.owner = this;
+    job.generation = mGeneration;
+    if(RenderJob::BACKGROUND != priority)
+    {
+        job.deadline = RenderStats::now() + RENDER_DEADLINE * 1000;
+
+        // Expensive pages are known to miss the deadline, so their preview is not waited for:
+        if(isExpensivePage(key.pageNumber))
+        {
+            mDeadlineTimer->start(0);
+        }
+        else if(!mDeadlineTimer->isActive())
+        {
+            mDeadlineTimer->start(RENDER_DEADLINE);
+        }
+    }
+    mDocument->render(job);
+}
+
+void
+PdfViewer::requestWholePage(
+        int const pageNumber,
+        qreal const scale,
+        int const renderHints,
+        RenderJob::Priority const priority
+)
+{
+    // No single image may exceed the pixel cap, however large the page or the zoom. Beyond it, the page is rendered
+    // downsampled as a whole, and at full resolution only as tiles covering its visible part plus a margin:
+    qreal const cappedScale = wholePageScale(pageNumber, scale);
+    if(cappedScale < scale
+            && equalReals(scale, computeScale())
+            && (mContinuous || pageNumber == mPageNumber)
+            && !mFramebuffer.isNull())
+    {
+        int const margin = TileCache::TILE_SIZE;
+        requestTiles(pageNumber, QRect(QPoint(0, 0), viewport()).adjusted(-margin, -margin, margin, margin), priority);
+    }
+
+    TileKey const key = TileKey::wholePage(pageNumber, cappedScale, pageOrientation(), renderHints);
+    if(mPendingTiles.contains(key))
+    {
+        return;
+    }
+    mPendingTiles.insert(key);
+
+    QSize const quad = pageQuad(pageNumber);
+
+    RenderJob job;
+    job.key = key;
+    job.pageNumber = pageNumber;
+    job.scale = cappedScale;
+    job.orientation = pageOrientation();
+    job.rect = QRect(QPoint(0, 0), quad * cappedScale);
+    job.target = RenderJob::WHOLE_PAGE;
+    job.priority = priority;
+    job.owner = this;
+    job.generation = mGeneration;
+    if(RenderJob::BACKGROUND != priority)
+    {
+        job.deadline = RenderStats::now() + RENDER_DEADLINE * 1000;
+    }
+    mDocument->render(job);
+}
+
+int
+PdfViewer::qualityRenderHints() const
+{
+    return (mRenderTextAntiAliased ? TileKey::TEXT_ANTI_ALIASED : 0)
+            | (mRenderImageAntiAliased ? TileKey::IMAGE_ANTI_ALIASED : 0);
+}
+
+bool
+PdfViewer::isExpensiveCost(
+        qreal const cost
+) const
+{
+    // Expensive means that a viewport full of such content would take the render threads longer than the render deadline:
+    qreal const viewportMegapixels = viewport().width() * viewport().height() / 1000000.0;
+    return cost * viewportMegapixels / qMax(1, QThread::idealThreadCount()) > RENDER_DEADLINE;
+}
+
+bool
+PdfViewer::isExpensivePage(
+        int const pageNumber
+) const
+{
+    return mExpensivePages.contains(pageNumber);
+}
+
+PdfViewer::InteractionQuality
+PdfViewer::pageInteractionQuality(
+        int const pageNumber
+) const
+{
+    // Expensive pages drop by one more tier, so they keep up with the interaction.
+    // Full quality is a promise though, e.g. for measuring the final quality, so only reduced tiers are lowered further:
+    if(isExpensivePage(pageNumber) && NOT_ANTI_ALIASED == mInteractionQuality)
+    {
+        return REDUCED_RESOLUTION;
+    }
+    return mInteractionQuality;
+}
+
+int
+PdfViewer::renderHints(
+        int const pageNumber
+) const
+{
+    return mInteracting && FULL_QUALITY != pageInteractionQuality(pageNumber) ? 0 : qualityRenderHints();
+}
+
+qreal
+PdfViewer::renderScale(
+        int const pageNumber
+) const
+{
+    return mInteracting && REDUCED_RESOLUTION == pageInteractionQuality(pageNumber) ? computeScale() / 2 : computeScale();
+}
+
+qreal
+PdfViewer::wholePageScale(
+        int const pageNumber,
+        qreal const scale
+) const
+{
+    QSize const quad = pageQuad(pageNumber);
+    qint64 const pixels = static_cast<qint64>(quad.width() * scale) * static_cast<qint64>(quad.height() * scale);
+    if(pixels <= MAX_WHOLE_PAGE_PIXELS)
+    {
+        return scale;
+    }
+
+    // Both sides shrink by the same factor, rounded down to the precision scales are cached with:
+    return qFloor(scale * qSqrt(static_cast<qreal>(MAX_WHOLE_PAGE_PIXELS) / pixels) * 1000) / 1000.0;
+}
+
+QImage
+PdfViewer::cachedWholePage(
+        int const pageNumber,
+        qreal const scale
+) const
+{
+    // Pages beyond the pixel cap are only ever cached downsampled, so the image may be smaller than the scale tells.
+    // A page rendered at full quality is preferred, even while interacting:
+    qreal const cappedScale = wholePageScale(pageNumber, scale);
+    QImage const wholePage = mDocument->tileCache().tile(TileKey::wholePage(pageNumber, cappedScale, pageOrientation(), qualityRenderHints()));
+    if(!wholePage.isNull() || renderHints(pageNumber) == qualityRenderHints())
+    {
+        return wholePage;
+    }
+    return mDocument->tileCache().tile(TileKey::wholePage(pageNumber, cappedScale, pageOrientation(), renderHints(pageNumber)));
+}
+
+void
+PdfViewer::prefetchNeighbourPages()
+{
+    // Only prefetch while the viewer is idle, otherwise wait for the next chance:
+    if(OK != mStatus || !mPendingTiles.isEmpty() || mSlidingOutPage || mInteracting)
+    {
+        return;
+    }
+
+    // Whole pages would be huge when zoomed into a continuous layout, where they are scrolled into view tile by tile anyway:
+    if(mContinuous && !equalReals(zoom(), fitZoom()))
+    {
+        return;
+    }
+
+    // Nearest pages first, as they are the most likely to be visited next.
+    // Expensive pages are prefetched from further away, so they are ready by the time they are reached.
+    // Pages not rasterized yet are judged by the document's average cost:
+    qreal const averageCost = mDocument->averageRenderCost();
+    for(int distance = 1; distance <= mPrefetchRadius * EXPENSIVE_PREFETCH_FACTOR; distance++)
+    {
+        int const neighbours[] = { mPageNumber + distance, mPageNumber - distance };
+        for(int i = 0; i < 2; i++)
+        {
+            int const pageNumber = neighbours[i];
+            if(pageNumber < 0 || pageNumber >= mDocument->pageCount())
+            {
+                continue;
+            }
+            qreal const cost = mDocument->pageRenderCost(pageNumber);
+            if(distance > mPrefetchRadius && !isExpensiveCost(cost >= 0 ? cost : averageCost))
+            {
+                continue;
+            }
+
+            qreal const scale = mContinuous ? computeScale() : fitScale(pageQuad(pageNumber));
+            if(cachedWholePage(pageNumber, scale).isNull())
+            {
+                requestWholePage(pageNumber, scale, qualityRenderHints(), RenderJob::BACKGROUND);
+            }
+        }
+    }
+}
+
+void
+PdfViewer::prefetchAhead(
+        QPointF const &velocity
+)
+{
+    if(OK != mStatus || mFramebuffer.isNull() || !mZoomPreview.isNull())
+    {
+        return;
+    }
+
+    // Where the viewport is going to be shortly, as far as the current velocity tells, but not more than a viewport ahead.
+    // Panning moves the content, so the viewport moves through the page in the opposite direction:
+    QSize const size = viewport();
+    QPoint const ahead(
+                qBound(-size.width(), qRound(-velocity.x() * PREFETCH_LOOKAHEAD), size.width()),
+                qBound(-size.height(), qRound(-velocity.y() * PREFETCH_LOOKAHEAD), size.height()));
+    if(ahead.isNull())
+    {
+        return;
+    }
+    QRect const aheadRect = QRect(QPoint(0, 0), size).translated(ahead);
+
+    // Missing tiles of the area ahead are rendered behind the visible ones:
+    int firstPage;
+    int lastPage;
+    visiblePages(aheadRect, firstPage, lastPage);
+    for(int pageNumber = qMax(0, firstPage); pageNumber <= lastPage; pageNumber++)
+    {
+        requestTiles(pageNumber, aheadRect, RenderJob::BACKGROUND);
+    }
+}
+
+void
+PdfViewer::requestTiles(
+        int const pageNumber,
+        QRect const &viewportSpaceRect,
+        RenderJob::Priority const priority
+)
+{
+    QPoint const translation = pan() + zoomPan() + pageOrigin(pageNumber);
+    QRect const pageRect(QPoint(0, 0), pageQuad(pageNumber) * computeScale());
+    QRect const visiblePdf = viewportSpaceRect.translated(-translation) & pageRect;
+    if(visiblePdf.isEmpty())
+    {
+        return;
+    }
+
+    // Nothing is missing if the page has been cached as a whole at the current scale:
+    QImage const wholePage = cachedWholePage(pageNumber, computeScale());
+    if(!wholePage.isNull() && wholePage.size() == pageRect.size())
+    {
+        return;
+    }
+
+    // Tiles are requested at the resolution they are rendered at right now:
+    qreal const factor = computeScale() / renderScale(pageNumber);
+    QRect const renderPageRect(QPoint(0, 0), pageQuad(pageNumber) * renderScale(pageNumber));
+    QRect const renderVisiblePdf = QRectF(QPointF(visiblePdf.topLeft()) / factor, QSizeF(visiblePdf.size()) / factor).toAlignedRect() & renderPageRect;
+
+    int const lastColumn = renderVisiblePdf.right() / TileCache::TILE_SIZE;
+    int const lastRow = renderVisiblePdf.bottom() / TileCache::TILE_SIZE;
+    for(int row = renderVisiblePdf.top() / TileCache::TILE_SIZE; row <= lastRow; row++)
+    {
+        for(int column = renderVisiblePdf.left() / TileCache::TILE_SIZE; column <= lastColumn; column++)
+        {
+            TileKey const key(pageNumber, renderScale(pageNumber), pageOrientation(), renderHints(pageNumber), column, row);
+            if(mDocument->tileCache().tile(key).isNull())
+            {
+                requestTile(key, TileCache::tileRect(column, row, renderPageRect), priority);
+            }
+        }
+    }
+}
+
+void
+PdfViewer::composeRenderedImage(
+        RenderJob const &job,
+        QImage const &image
+)
+{
+    // Thumbnails are of no use for the viewer itself:
+    if(RenderJob::THUMBNAIL == job.target)
+    {
+        return;
+    }
+
+    // The image has already been cached by the shared document, and might as well have been requested by another viewer.
+    // Tiles fit the view if rendered at the current resolution and quality, anything rendered at full quality always does:
+    qreal const scale = RenderJob::FRAMEBUFFER == job.target ? renderScale(job.pageNumber) : computeScale();
+    bool const currentViewState = (mContinuous || job.pageNumber == mPageNumber)
+            && job.orientation == pageOrientation()
+            && ((job.key.renderHints == renderHints(job.pageNumber) && equalReals(job.scale, scale))
+                || (job.key.renderHints == qualityRenderHints() && equalReals(job.scale, computeScale())));
+
+    // Only the jobs of this viewer count for its statistics:
+    if(mPendingTiles.remove(job.key) && !image.isNull())
+    {
+        mStats->addRender(static_cast<qint64>(job.rect.width()) * job.rect.height(), job.renderStart, job.renderDuration, job.worker);
+    }
+    updateBusy();
+
+    // A page which could not be rasterized is left blank. It is not prefetched again right away, as that would fail just as well:
+    if(image.isNull())
+    {
+        return;
+    }
+
+    // Once all visible tiles have arrived, the viewer is idle and may start prefetching:
+    if(mPendingTiles.isEmpty())
+    {
+        mPrefetchTimer->start();
+    }
+
+    // The page sliding in may arrive downsampled, so it is looked up just like when the slide started:
+    if(mSlidingInPage && mSlidingImagePending && RenderJob::WHOLE_PAGE == job.target && job.pageNumber == mPageNumber)
+    {
+        mSlidingImage = cachedWholePage(mPageNumber, computeScale());
+        mSlidingImagePending = mSlidingImage.isNull();
+        update();
+    }
+
+    if(mSlidingOutPage || mFramebuffer.isNull() || !mZoomPreview.isNull())
+    {
+        return;
+    }
+
+    // A level of detail arriving ahead of the exact tiles of its page stands in for them meanwhile:
+    if(!currentViewState)
+    {
+        if(RenderJob::WHOLE_PAGE == job.target
+                && (mContinuous || job.pageNumber == mPageNumber)
+                && job.orientation == pageOrientation()
+                && job.key.renderHints == qualityRenderHints())
+        {
+            drawLevelIntoPendingTiles(job.pageNumber);
+        }
+        return;
+    }
+
+    // The tile is placed in page space, so it lands at the right spot even if the page has been panned meanwhile.
+    // Tiles of reduced resolution are stretched to the current scale:
+    qreal const factor = computeScale() / job.scale;
+    if(equalReals(factor, 1))
+    {
+        QPoint const position = pan() + zoomPan() + pageOrigin(job.pageNumber) + job.rect.topLeft();
+        mFramebuffer.blit(position, image, image.rect());
+        update(QRectF(position, image.size()));
+    }
+    else
+    {
+        QRectF const target(QPointF(pan() + zoomPan() + pageOrigin(job.pageNumber)) + QPointF(job.rect.topLeft()) * factor, QSizeF(image.size()) * factor);
+        mFramebuffer.draw(target, image, QRectF(image.rect()));
+        update(target);
+    }
+}
+
+bool
+PdfViewer::busy() const
+{
+    return mBusy;
+}
+
+RenderStats *
+PdfViewer::stats() const
+{
+    return mStats;
+}
+
+QString
+PdfViewer::traceFile() const
+{
+    return mStats->traceFile();
+}
+
+void
+PdfViewer::setTraceFile(
+        QString const &traceFile
+)
+{
+    if(traceFile != mStats->traceFile())
+    {
+        mStats->setTraceFile(traceFile);
+        emit traceFileChanged();
+    }
+}
+
+void
+PdfViewer::updateBusy()
+{
+    // Busy while opening and as long as there is anything to render for the current view, including its refinement
+    // after an interaction, prefetched pages aside:
+    int firstPage;
+    int lastPage;
+    visiblePages(QRect(QPoint(0, 0), viewport()), firstPage, lastPage);
+    bool busy = LOADING == mStatus || !mZoomPreview.isNull() || !mRenderRegion.isEmpty() || mRefinementPending;
+    for(QSet<TileKey>::const_iterator tile = mPendingTiles.constBegin(); !busy && tile != mPendingTiles.constEnd(); ++tile)
+    {
+        // Whole pages are only rendered ahead of time or as levels of detail, the visible content comes in tiles:
+        busy = tile->pageNumber >= firstPage && tile->pageNumber <= lastPage && TileKey::WHOLE_PAGE != tile->column;
+    }
+
+    if(busy != mBusy)
+    {
+        mBusy = busy;
+        emit busyChanged();
+    }
+}
+
+void
+PdfViewer::paint(
+        QPainter * const painter,
+        QStyleOptionGraphicsItem const * const option,
+        QWidget * const
+)
+{
+    qint64 const paintStart = RenderStats::now();
+
+    // While zoom is settling, show the last sharp frame transformed to the current zoom and pan:
+    if(!mZoomPreview.isNull())
+    {
+        QRect const viewportRect(QPoint(0, 0), viewport());
+        painter->fillRect(viewportRect, mBackgroundColor);
+
+        // Levels of detail show through where the preview does not reach, and are laid over it where they are sharper:
+        int firstPage = 0;
+        int lastPage = -1;
+        if(OK == mStatus)
+        {
+            visiblePages(viewportRect, firstPage, lastPage);
+        }
+        painter->save();
+        painter->setRenderHint(QPainter::SmoothPixmapTransform);
+        for(int pass = 0; pass < 2; pass++)
+        {
+            for(int pageNumber = qMax(0, firstPage); pageNumber <= lastPage; pageNumber++)
+            {
+                qreal levelScale;
+                QImage const level = levelOfDetail(pageNumber, levelScale);
+                QRectF target;
+                QRectF source;
+                if(!level.isNull() && (levelScale > mZoomPreviewScale) == (1 == pass)
+                        && levelOfDetailRects(pageNumber, viewportRect, levelScale, target, source))
+                {
+                    painter->drawImage(target, level, source);
+                }
+            }
+            if(0 == pass)
+            {
+                painter->drawImage(zoomPreviewRect(), mZoomPreview, QRectF(mZoomPreview.rect()));
+            }
+        }
+        painter->restore();
+        mStats->addPaint(paintStart);
+        return;
+    }
+
+    // While sliding, the page is painted straight from the sliding image, the framebuffer is not touched at all:
+    if(mSlidingOutPage)
+    {
+        QRect const pageRect(QPoint(mSlidingOffset, fitPan().y()), scaledPageQuad());
+        QRegion const background = QRegion(QRect(QPoint(0, 0), viewport())) - pageRect;
+        for(int i = 0; i < background.rectCount(); i++)
+        {
+            painter->fillRect(background.rects()[i], mBackgroundColor);
+        }
+
+        // A page still on its way is shown blank, a downsampled one is stretched to its place:
+        if(mSlidingImage.isNull())
+        {
+            painter->fillRect(pageRect, Qt::white);
+        }
+        else if(mSlidingImage.size() == pageRect.size())
+        {
+            painter->drawImage(pageRect.topLeft(), mSlidingImage);
+        }
+        else
+        {
+            painter->save();
+            painter->setRenderHint(QPainter::SmoothPixmapTransform);
+            painter->drawImage(QRectF(pageRect), mSlidingImage, QRectF(mSlidingImage.rect()));
+            painter->restore();
+        }
+        mStats->addPaint(paintStart);
+        return;
+    }
+
+    allocateFramebuffer();
+
+    for(int i = 0; i < mRenderRegion.rectCount(); i++)
+    {
+        qint64 const renderStart = RenderStats::now();
+        renderPdfIntoFramebuffer(mRenderRegion.rects()[i], mKeepStaleContent);
+        mStats->addSpan("renderPdfIntoFramebuffer", renderStart);
+    }
+
     // Clean render regions:
     mRenderRegion = QRect();
+    mKeepStaleContent = false;
+    mFramebufferScale = computeScale();
+    updateBusy();
 
-    painter->drawPixmap(0, 0, mFramebuffer);
+    // Only the exposed part is uploaded, the framebuffer is already in the paint engine's native format:
+    mFramebuffer.paint(painter, option->exposedRect.toAlignedRect());
+    mStats->addPaint(paintStart);
 }
 
 } // namespace pdf_viewer
@@ -2,11 +2,22 @@
 #define PDFVIEWER_H
 
 #include <QDeclarativeItem>
+#include <QElapsedTimer>
 #include <QRegion>
-#include <QPixmap>
+#include <QImage>
+#include <QSet>
+#include <QSharedPointer>
+#include <QVector>
 
+#include "Framebuffer.h"
+#include "KineticAnimation.h"
 #include "PdfDocument.h"
 #include "Polynomial.h"
+#include "RenderPool.h"
+#include "RenderStats.h"
+#include "SharedDocument.h"
+#include "SlideAnimation.h"
+#include "TileCache.h"
 
 #ifndef Q_NULLPTR
 #define Q_NULLPTR NULL
@@ -14,7 +25,6 @@
 
 namespace Poppler {
     class Document;
-    class Page;
 }
 class QTimer;
 
@@ -28,7 +38,7 @@ class PdfViewer : public QDeclarativeItem
 {
 
     Q_OBJECT
-    Q_ENUMS(Status PageOrientation)
+    Q_ENUMS(Status PageOrientation InteractionQuality)
 
 public:
 
@@ -45,6 +55,14 @@ public:
      */
     Q_PROPERTY(int pageNumber READ pageNumber WRITE setPageNumber NOTIFY pageNumberChanged)
 
+    /*!
+     * \brief Whether all pages are laid out below each other and scrolled through continuously.
+     * Pages are then shown at a common scale, fitting the widest page to the viewport width at fit zoom.
+     * The page number follows the page at the viewport center, setting it scrolls to the top of that page.
+     * Only pages intersecting the viewport are rendered, so scrolling costs the same for any document length.
+     */
+    Q_PROPERTY(bool continuous READ continuous WRITE setContinuous NOTIFY continuousChanged)
+
     /*!
      * \brief The current document status.
      * The status is set to *not opened* as long as no document has
@@ -84,6 +102,87 @@ public:
      */
     Q_PROPERTY(bool renderImageAntiAliased READ renderImageAntiAliased WRITE setRenderImageAntiAliased NOTIFY renderImageAntiAliasedChanged)
 
+    /*!
+     * \brief Maximum amount of memory in bytes occupied by cached page tiles.
+     * Rendered tiles are kept until the budget is exceeded, least recently used ones are evicted first.
+     * Panning over an area whose tiles are still cached requires no rendering at all.
+     * The cache is shared by all viewers showing the same document, the budget set last applies.
+     */
+    Q_PROPERTY(int tileCacheBudget READ tileCacheBudget WRITE setTileCacheBudget NOTIFY tileCacheBudgetChanged)
+
+    /*!
+     * \brief Directory of a persistent cache of rendered tiles, which is disabled while empty.
+     * Images are identified by the document's content, so reopening a recently viewed document
+     * paints from the cache instead of rasterizing again. The cache is shared by all viewers
+     * showing the same document, the directory set last applies.
+     */
+    Q_PROPERTY(QString diskCacheDirectory READ diskCacheDirectory WRITE setDiskCacheDirectory NOTIFY diskCacheDirectoryChanged)
+
+    /*!
+     * \brief Maximum size of the persistent cache in megabytes, the oldest images are evicted first.
+     */
+    Q_PROPERTY(int diskCacheSize READ diskCacheSize WRITE setDiskCacheSize NOTIFY diskCacheSizeChanged)
+
+    /*!
+     * \brief Number of pages before and after the current one which are rendered in advance.
+     * Neighbouring pages are rendered at fit scale in the background whenever the viewer is idle,
+     * so switching or sliding to them does not need to wait for the renderer.
+     * Pages measured to be expensive to render are prefetched from twice as far.
+     */
+    Q_PROPERTY(int prefetchRadius READ prefetchRadius WRITE setPrefetchRadius NOTIFY prefetchRadiusChanged)
+
+    /*!
+     * \brief Time in milliseconds zoom has to remain unchanged before the page is rendered sharply again.
+     * Until then, the last sharp frame is shown scaled to the current zoom. Where that frame does not reach,
+     * or where a sharper one is at hand, the pages are shown from their nearest cached level of detail:
+     * whole page images at power-of-two scales, which are rendered in the background for every zoom visited.
+     */
+    Q_PROPERTY(int zoomSettleInterval READ zoomSettleInterval WRITE setZoomSettleInterval NOTIFY zoomSettleIntervalChanged)
+
+    /*!
+     * \brief Whether a flicked page keeps moving after release, slowing down gradually. On by default.
+     * While the page moves, tiles ahead of the viewport are prefetched in the direction of motion.
+     */
+    Q_PROPERTY(bool kineticScrolling READ kineticScrolling WRITE setKineticScrolling NOTIFY kineticScrollingChanged)
+
+    /*!
+     * \brief How pages are rendered while the user pans, zooms or slides pages.
+     * Content exposed during an interaction is on screen for a few frames only, so it may be rendered faster at lower quality.
+     * Once the view has been left alone for refinementDelay milliseconds, the visible area is rendered again at the quality
+     * set by renderTextAntiAliased and renderImageAntiAliased. Defaults to NOT_ANTI_ALIASED.
+     * Unless at FULL_QUALITY, pages measured to be expensive to render drop to REDUCED_RESOLUTION while interacting.
+     */
+    Q_PROPERTY(InteractionQuality interactionQuality READ interactionQuality WRITE setInteractionQuality NOTIFY interactionQualityChanged)
+
+    /*!
+     * \brief Time in milliseconds without any pan, zoom or slide after which an interaction is considered finished.
+     */
+    Q_PROPERTY(int refinementDelay READ refinementDelay WRITE setRefinementDelay NOTIFY refinementDelayChanged)
+
+    /*!
+     * \brief Whether the user is currently panning, zooming or sliding pages.
+     * Zooming counts if driven by input, i.e. by double-click, zoomIn() or zoomOut(), but not by setting zoom itself,
+     * which is also done programmatically, e.g. when fitting the page.
+     */
+    Q_PROPERTY(bool interacting READ interacting NOTIFY interactingChanged)
+
+    /*!
+     * \brief Whether the visible page area is still being rendered.
+     * Prefetching in the background does not count as being busy.
+     */
+    Q_PROPERTY(bool busy READ busy NOTIFY busyChanged)
+
+    /*!
+     * \brief Counters of the rendering work done by this viewer, for profiling.
+     */
+    Q_PROPERTY(pdf_viewer::RenderStats *stats READ stats CONSTANT)
+
+    /*!
+     * \brief File the spans of rasterizations, paints and animation frames are written to, in the Chrome trace event format.
+     * Tracing is off while empty, which is the default.
+     */
+    Q_PROPERTY(QString traceFile READ traceFile WRITE setTraceFile NOTIFY traceFileChanged)
+
     /*!
      * Rotate page clockwise by π/2 or 45°.
      */
@@ -155,6 +254,41 @@ public:
      */
     Q_INVOKABLE void zoomOut(qreal const factor);
 
+    /*!
+     * \brief Fraction of pages whose text has been indexed for searching, from 0 to 1.
+     * Text is extracted in the background once the document is searched for the first time, searching works meanwhile.
+     */
+    Q_PROPERTY(qreal textIndexProgress READ textIndexProgress NOTIFY textIndexProgressChanged)
+
+    /*!
+     * \brief Searches the document's text, as far as it has been indexed, starting to index it with the first search.
+     * Words are matched case-insensitively and in succession, the last one also as prefix.
+     * \param text The words to search for.
+     * \return Hits in document order, each a map of its `pageNumber` and the `rects` of the matched words.
+     * The rects are given in points of the upright page, use mapFromPage() to highlight them.
+     */
+    Q_INVOKABLE QVariantList search(QString const &text);
+
+    /*!
+     * \brief Maps a rect in points of an upright page to viewer coordinates, respecting orientation, zoom and pan.
+     * \param pageNumber Page the rect lies on.
+     * \param rect Rect in points, as returned by search().
+     */
+    Q_INVOKABLE QRectF mapFromPage(int pageNumber, QRectF const &rect) const;
+
+    /*!
+     * \brief Milliseconds spent in rasterizing a page during this session, by all viewers of the document.
+     */
+    Q_INVOKABLE qreal pageRenderTime(int pageNumber) const;
+
+    /*!
+     * \brief Measured cost of rasterizing a page in milliseconds per megapixel, or -1 if it has not been rasterized yet.
+     * A page is considered expensive once a viewport full of it would take the render threads longer than the render deadline.
+     * Expensive pages are prefetched earlier, previewed at a lower resolution and, unless interactionQuality is FULL_QUALITY,
+     * rendered at a reduced resolution while interacting.
+     */
+    Q_INVOKABLE qreal pageRenderCost(int pageNumber) const;
+
     /*!
      * \brief The page status.
      */
@@ -163,7 +297,8 @@ public:
         OK,                     //!< Everything is okay. Implies that the document pointer is not Q_NULLPTR.
         CANNOT_OPEN_DOCUMENT,   //!< The document cannot be opened, e.g. the path is invalid or the file just doesn't exist
         NO_PAGES,               //!< The document has no pages to display
-        DOCUMENT_IS_LOCKED      //!< A password is required to open the document
+        DOCUMENT_IS_LOCKED,     //!< A password is required to open the document
+        LOADING                 //!< The document is being opened in the background
     };
 
     /*!
@@ -176,12 +311,22 @@ public:
         ONE_HALF_PI             //!< 1.5π, counter-clockwise
     };
 
+    /*!
+     * \brief Render quality while interacting.
+     */
+    enum InteractionQuality {
+        FULL_QUALITY,           //!< Always render at the configured quality
+        NOT_ANTI_ALIASED,       //!< Render without any anti-aliasing while interacting
+        REDUCED_RESOLUTION      //!< Render without any anti-aliasing and at half resolution while interacting
+    };
+
     PdfViewer(QDeclarativeItem * const parent = Q_NULLPTR);
 
     virtual ~PdfViewer();
 
     QString source() const;
     int pageNumber() const;
+    bool continuous() const;
     Status status() const;
     QString statusMessage() const;
     PdfDocument *info() const;
@@ -196,11 +341,25 @@ public:
     QColor backgroundColor() const;
     bool renderTextAntiAliased() const;
     bool renderImageAntiAliased() const;
+    int tileCacheBudget() const;
+    QString diskCacheDirectory() const;
+    int diskCacheSize() const;
+    int prefetchRadius() const;
+    int zoomSettleInterval() const;
+    bool kineticScrolling() const;
+    InteractionQuality interactionQuality() const;
+    int refinementDelay() const;
+    bool interacting() const;
+    bool busy() const;
+    RenderStats *stats() const;
+    QString traceFile() const;
+    qreal textIndexProgress() const;
 
 public slots:
 
     void setSource(QString const &source);
     void setPageNumber(int pageNumber);
+    void setContinuous(bool const continuous);
     void setPan(QPoint pan);
     void setZoom(qreal zoom);
     void setMaxZoom(qreal maxZoom);
@@ -208,12 +367,22 @@ public slots:
     void setBackgroundColor(QColor const backgroundColor);
     void setRenderTextAntiAliased(bool const on);
     void setRenderImageAntiAliased(bool const on);
+    void setTileCacheBudget(int const budget);
+    void setDiskCacheDirectory(QString const &diskCacheDirectory);
+    void setDiskCacheSize(int diskCacheSize);
+    void setPrefetchRadius(int prefetchRadius);
+    void setZoomSettleInterval(int zoomSettleInterval);
+    void setKineticScrolling(bool const kineticScrolling);
+    void setInteractionQuality(InteractionQuality const interactionQuality);
+    void setRefinementDelay(int refinementDelay);
+    void setTraceFile(QString const &traceFile);
 
 signals:
 
     void sourceChanged();
     void infoChanged();
     void pageNumberChanged();
+    void continuousChanged();
     void statusChanged();
     void panChanged();
     void zoomChanged();
@@ -223,6 +392,23 @@ signals:
     void backgroundColorChanged();
     void renderTextAntiAliasedChanged();
     void renderImageAntiAliasedChanged();
+    void tileCacheBudgetChanged();
+    void diskCacheDirectoryChanged();
+    void diskCacheSizeChanged();
+    void prefetchRadiusChanged();
+    void zoomSettleIntervalChanged();
+    void kineticScrollingChanged();
+    void interactionQualityChanged();
+    void refinementDelayChanged();
+    void interactingChanged();
+    void busyChanged();
+    void traceFileChanged();
+    void textIndexProgressChanged();
+
+    /*!
+     * \brief Emitted whenever the render cost of a page has been measured again.
+     */
+    void pageRenderCostChanged(int pageNumber);
 
 protected:
 
@@ -231,40 +417,107 @@ protected:
     virtual void mouseReleaseEvent(QGraphicsSceneMouseEvent * const event);
     virtual void mouseMoveEvent(QGraphicsSceneMouseEvent * const event);
     virtual void mouseDoubleClickEvent(QGraphicsSceneMouseEvent * const event);
-    virtual void timerEvent(QTimerEvent *event);
+    virtual void geometryChanged(QRectF const &newGeometry, QRectF const &oldGeometry);
+
+private:
+
+    /*!
+     * \brief Geometry of the current view, derived from page, orientation, zoom and viewport.
+     * It is recomputed lazily after any of those has changed, so panning only costs a lookup.
+     */
+    struct ViewTransform
+    {
+        QSize pageQuad;         //!< Oriented page size in points, in continuous mode the size of the whole layout
+        QSize scaledPageQuad;   //!< Page quad in pixels at the current scale
+        qreal scale;            //!< Current scale relative to 72 DPI
+        qreal fitScale;         //!< Scale at which the page fits into the viewport
+        qreal coverScale;       //!< Scale at which the page covers the viewport
+        QPoint zoomPan;         //!< Translation keeping the page centered while zooming
+        QPoint fitPan;          //!< Pan centering the page at fit zoom
+        QPoint coverPan;        //!< Pan centering the page at cover zoom
+    };
+
+    ViewTransform const &viewTransform() const;
+    void invalidateViewTransform();
+
+    void applyDiskCache();
+    void updateLayout();
+    int pageAt(qreal const y) const;
+    QPoint pageOrigin(int const pageNumber) const;
+    void visiblePages(QRect const &viewportSpaceRect, int &first, int &last) const;
+    void renderPageIntoFramebuffer(int const pageNumber, QRect const &viewportSpaceRect, bool const keepStaleContent);
+    qreal levelScale(int const pageNumber) const;
+    QImage levelOfDetail(int const pageNumber, qreal &levelScale) const;
+    bool levelOfDetailRects(int const pageNumber, QRect const &viewportSpaceRect, qreal const levelScale, QRectF &target, QRectF &source) const;
+    void drawLevelIntoPendingTiles(int const pageNumber);
+    void beginInteraction();
+    bool isExpensiveCost(qreal const cost) const;
+    bool isExpensivePage(int const pageNumber) const;
+    InteractionQuality pageInteractionQuality(int const pageNumber) const;
+    int qualityRenderHints() const;
+    int renderHints(int const pageNumber) const;
+    qreal renderScale(int const pageNumber) const;
+    qreal wholePageScale(int const pageNumber, qreal const scale) const;
+    QImage cachedWholePage(int const pageNumber, qreal const scale) const;
+    void startSlide(Polynomial const &curve);
 
 private slots:
 
+    void openLoadedDocument();
+    void openRecoveredPages();
+    void showSlideFrame(int const offset);
+    void finishSlide();
+    void kineticStep(QPoint const &delta);
+    void refine();
     void setStatus(Status const status);
     QSize pageQuad() const;
+    QSize pageQuad(int const pageNumber) const;
     QSize scaledPageQuad() const;
     QSize viewport() const;
     qreal computeScale() const;
     qreal fitScale() const;
+    qreal fitScale(QSize const &pageQuad) const;
     qreal coverScale() const;
     void resetToFitPanIfFitZoom();
     void resetPageViewToFit();
+    void showFirstPage();
     void requestRenderWholePdf();
+    void scheduleFramebufferResize();
     void allocateFramebuffer();
-    void renderPdfIntoFramebuffer(QRect const viewportSpaceRect);
+    void renderPdfIntoFramebuffer(QRect const viewportSpaceRect, bool const keepStaleContent = false);
+    void cancelObsoleteJobs();
+    void dropCancelledJob(pdf_viewer::RenderJob const &job);
+    void previewMissedDeadline();
+    void updatePageRenderCost(int const pageNumber);
+    void requestTile(pdf_viewer::TileKey const &key, QRect const &tileRect, pdf_viewer::RenderJob::Priority const priority = pdf_viewer::RenderJob::INTERACTIVE);
+    void requestTiles(int const pageNumber, QRect const &viewportSpaceRect, pdf_viewer::RenderJob::Priority const priority);
+    void prefetchAhead(QPointF const &velocity);
+    void composeRenderedImage(pdf_viewer::RenderJob const &job, QImage const &image);
+    void discardTiles();
+    QRectF zoomPreviewRect() const;
+    void settleZoom();
+    void discardZoomPreview();
+    void updateBusy();
+    void requestWholePage(int const pageNumber, qreal const scale, int const renderHints, pdf_viewer::RenderJob::Priority const priority);
+    void prefetchNeighbourPages();
     QPoint zoomPan() const;
-    QRect visiblePdfRect(QRect const viewportSpaceClip) const;
 
 private:
 
     Status mStatus;
     QString mSource;
-    Poppler::Document *mDocument;
-    Poppler::Page const *mPage;
+    QSharedPointer<SharedDocument> mDocument;
     int mPageNumber;
     PdfDocument *mInfo;
 
     QPoint mPan;
+    qreal mPanScale;
     qreal mZoom;
     qreal mMaxZoom;
     PageOrientation mPageOrientation;
 
-    QPixmap mFramebuffer;
+    Framebuffer mFramebuffer;
+    qreal mFramebufferScale;
     QRegion mRenderRegion;
     QColor mBackgroundColor;
     bool mRenderTextAntiAliased;
@@ -272,13 +525,65 @@ private:
 
     int mSlidingPull;
     bool mSlidingOutPage;
-    QTime mSlidingTStart;
-    Polynomial mSlidingPolynomial;
     QImage mSlidingImage;
+    bool mSlidingImagePending;
+    int mSlidingOffset;
+    qint64 mSlidingFrameTime;
+    SlideAnimation *mSlideAnimation;
+
+    bool mKineticScrolling;
+    KineticAnimation *mKineticAnimation;
+    QElapsedTimer mDragTimer;
+    QPointF mDragVelocity;
+
+    InteractionQuality mInteractionQuality;
+    bool mInteracting;
+    bool mRefinementPending;
+    QTimer *mRefinementTimer;
+
+    int mTileCacheBudget;
+    QString mDiskCacheDirectory;
+    int mDiskCacheSize;
+    QSet<TileKey> mPendingTiles;
+    int mGeneration;
+    QSet<int> mExpensivePages;
+    QTimer *mDeadlineTimer;
+    int mPrefetchRadius;
+    QTimer *mPrefetchTimer;
+
+    QTimer *mZoomSettleTimer;
+    QImage mZoomPreview;
+    qreal mZoomPreviewScale;
+    QPoint mZoomPreviewTranslation;
+    bool mKeepStaleContent;
+    qreal mStaleContentScale;
+    bool mBusy;
     bool mSlidingInPage;
 
+    mutable ViewTransform mViewTransform;
+    mutable bool mViewTransformValid;
+
+    bool mContinuous;
+    QVector<qreal> mPageOffsets;
+    qreal mLayoutWidth;
+
+    RenderStats *mStats;
+
     static const qreal SLIDE_ANIMATION_DURATION;
     static const int SLIDE_PULL_THRESHOLD;
+    static const int ZOOM_SETTLE_INTERVAL;
+    static const int PAGE_SPACING;
+    static const int MAX_SEARCH_HITS;
+    static const int FLICK_RELEASE_INTERVAL;
+    static const int PREFETCH_LOOKAHEAD;
+    static const int REFINEMENT_DELAY;
+    static const int MIN_LEVEL;
+    static const int MAX_LEVEL;
+    static const qint64 MAX_LEVEL_PIXELS;
+    static const qint64 MAX_WHOLE_PAGE_PIXELS;
+    static const int RENDER_DEADLINE;
+    static const int PREVIEW_LEVEL_OFFSET;
+    static const int EXPENSIVE_PREFETCH_FACTOR;
 
 };
 
@@ -0,0 +1,307 @@
+#include "RenderPool.h"
+#include "Framebuffer.h"
+#include "RenderStats.h"
+
+#include <QMutexLocker>
+
+#include <poppler/qt4/poppler-qt4.h>
+
+namespace pdf_viewer {
+
+RenderJob::RenderJob()
+    : pageNumber(-1)
+    , scale(1)
+    , orientation(0)
+    , target(FRAMEBUFFER)
+    , priority(INTERACTIVE)
+    , owner(Q_NULLPTR)
+    , generation(0)
+    , deadline(-1)
+    , renderStart(-1)
+    , renderDuration(0)
+    , worker(-1)
+{
+}
+
+RenderPool::RenderPool(
+        int const threadCount,
+        QObject * const parent
+)
+    : QObject(parent)
+    , mSourceSerial(0)
+    , mQuit(false)
+    , mFinishedWorkers(0)
+{
+    qRegisterMetaType<pdf_viewer::RenderJob>("pdf_viewer::RenderJob");
+
+    for(int i = 0; i < qMax(1, threadCount); i++)
+    {
+        RenderWorker * const worker = new RenderWorker(this, i);
+        connect(worker, SIGNAL(finished()), this, SLOT(releaseWorker()));
+        worker->start(QThread::LowPriority);
+        mWorkers.append(worker);
+    }
+}
+
+RenderPool::~RenderPool()
+{
+    qDeleteAll(mWorkers);
+}
+
+void
+RenderPool::detach()
+{
+    setParent(Q_NULLPTR);
+
+    QMutexLocker locker(&mMutex);
+    mQuit = true;
+    mJobs.clear();
+    mCondition.wakeAll();
+}
+
+void
+RenderPool::releaseWorker()
+{
+    // Workers only finish once the pool has been detached, the last one takes the pool along:
+    if(++mFinishedWorkers == mWorkers.size())
+    {
+        deleteLater();
+    }
+}
+
+void
+RenderPool::setSource(
+        QString const &source
+)
+{
+    QMutexLocker locker(&mMutex);
+    mSource = source;
+    mSourceSerial++;
+    mJobs.clear();
+}
+
+void
+RenderPool::setDiskCache(
+        QSharedPointer<DiskCache> const &diskCache,
+        QString const &documentHash
+)
+{
+    QMutexLocker locker(&mMutex);
+    mDiskCache = diskCache;
+    mDocumentHash = documentHash;
+}
+
+void
+RenderPool::enqueue(
+        RenderJob const &job
+)
+{
+    QMutexLocker locker(&mMutex);
+    int position = mJobs.size();
+    while(position > 0 && isMoreUrgent(job, mJobs.at(position - 1)))
+    {
+        position--;
+    }
+    mJobs.insert(position, job);
+    mCondition.wakeOne();
+}
+
+void
+RenderPool::promote(
+        RenderJob const &job
+)
+{
+    QMutexLocker locker(&mMutex);
+    for(int i = 0; i < mJobs.size(); i++)
+    {
+        if(!(mJobs.at(i).key == job.key))
+        {
+            continue;
+        }
+        if(!isMoreUrgent(job, mJobs.at(i)))
+        {
+            return;
+        }
+
+        // Requeue the job with the more urgent priority and deadline, it is picked up ahead of the less urgent ones:
+        RenderJob promoted = mJobs.takeAt(i);
+        promoted.priority = job.priority;
+        promoted.deadline = job.deadline;
+        int position = i;
+        while(position > 0 && isMoreUrgent(promoted, mJobs.at(position - 1)))
+        {
+            position--;
+        }
+        mJobs.insert(position, promoted);
+        return;
+    }
+}
+
+QList<RenderJob>
+RenderPool::cancel(
+        void const * const owner,
+        int const generation
+)
+{
+    QMutexLocker locker(&mMutex);
+    QList<RenderJob> cancelled;
+    for(int i = mJobs.size() - 1; i >= 0; i--)
+    {
+        if(owner == mJobs.at(i).owner && mJobs.at(i).generation < generation)
+        {
+            cancelled.prepend(mJobs.takeAt(i));
+        }
+    }
+    return cancelled;
+}
+
+bool
+RenderPool::isMoreUrgent(
+        RenderJob const &job,
+        RenderJob const &other
+)
+{
+    if(job.priority != other.priority)
+    {
+        return job.priority > other.priority;
+    }
+
+    // Jobs without a deadline queue up behind all others of their priority:
+    return job.deadline >= 0 && (other.deadline < 0 || job.deadline < other.deadline);
+}
+
+void
+RenderPool::clear()
+{
+    QMutexLocker locker(&mMutex);
+    mJobs.clear();
+}
+
+QImage
+RenderPool::deliver(
+        RenderJob const &job,
+        QImage const &image
+)
+{
+    // Any conversion is done here within the worker, so the GUI thread copies the image into its framebuffer as is.
+    // Opaque RGB32 images are laid out just like premultiplied ones already:
+    QImage const converted = image.isNull() || Framebuffer::FORMAT == image.format() || QImage::Format_RGB32 == image.format()
+            ? image
+            : image.convertToFormat(Framebuffer::FORMAT);
+
+    // Called from within a worker thread, so receivers in the GUI thread get a queued signal:
+    emit rendered(job, converted);
+    return converted;
+}
+
+RenderWorker::RenderWorker(
+        RenderPool * const pool,
+        int const index
+)
+    : QThread()
+    , mPool(pool)
+    , mIndex(index)
+{
+}
+
+void
+RenderWorker::run()
+{
+    Poppler::Document *document = Q_NULLPTR;
+    bool documentOpened = false;
+    QString source;
+    int sourceSerial = 0;
+
+    forever
+    {
+        QMutexLocker locker(&mPool->mMutex);
+        while(!mPool->mQuit && mPool->mJobs.isEmpty())
+        {
+            mPool->mCondition.wait(&mPool->mMutex);
+        }
+        if(mPool->mQuit)
+        {
+            break;
+        }
+
+        // Another document is only opened once a job actually needs to be rasterized:
+        if(sourceSerial != mPool->mSourceSerial)
+        {
+            source = mPool->mSource;
+            sourceSerial = mPool->mSourceSerial;
+            documentOpened = false;
+        }
+
+        RenderJob job = mPool->mJobs.takeFirst();
+        job.worker = mIndex;
+        QSharedPointer<DiskCache> const diskCache = mPool->mDiskCache;
+        QString const documentHash = mPool->mDocumentHash;
+        locker.unlock();
+
+        // Images found on disk need no rasterization at all:
+        if(diskCache)
+        {
+            QImage const image = diskCache->load(documentHash, job.key);
+            if(!image.isNull())
+            {
+                mPool->deliver(job, image);
+                continue;
+            }
+        }
+
+        if(!documentOpened)
+        {
+            // Open the document without holding the lock, as that may take a while:
+            delete document;
+            document = Poppler::Document::load(source);
+            if(document && document->isLocked())
+            {
+                delete document;
+                document = Q_NULLPTR;
+            }
+            documentOpened = true;
+        }
+
+        // Jobs which cannot be rasterized are delivered without an image, so nobody keeps waiting for them:
+        if(!document)
+        {
+            mPool->deliver(job, QImage());
+            continue;
+        }
+
+        Poppler::Page * const page = document->page(job.pageNumber);
+        if(!page)
+        {
+            mPool->deliver(job, QImage());
+            continue;
+        }
+
+        // Jobs of different viewers may ask for different render hints:
+        document->setRenderHint(Poppler::Document::TextAntialiasing, 0 != (job.key.renderHints & TileKey::TEXT_ANTI_ALIASED));
+        document->setRenderHint(Poppler::Document::Antialiasing, 0 != (job.key.renderHints & TileKey::IMAGE_ANTI_ALIASED));
+
+        job.renderStart = RenderStats::now();
+        QImage const image = page->renderToImage(
+                    72.0 * job.scale,
+                    72.0 * job.scale,
+                    job.rect.x(),
+                    job.rect.y(),
+                    job.rect.width(),
+                    job.rect.height(),
+                    static_cast<Poppler::Page::Rotation>(job.orientation));
+        job.renderDuration = RenderStats::now() - job.renderStart;
+        delete page;
+
+        QImage const delivered = mPool->deliver(job, image);
+
+        // Store the image after delivering it, nobody is waiting for that:
+        if(diskCache)
+        {
+            diskCache->store(documentHash, job.key, delivered);
+        }
+    }
+
+    delete document;
+}
+
+} // namespace pdf_viewer
@@ -0,0 +1,200 @@
+#ifndef RENDERPOOL_H
+#define RENDERPOOL_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QList>
+#include <QRect>
+#include <QImage>
+#include <QMetaType>
+#include <QSharedPointer>
+
+#include "DiskCache.h"
+#include "TileCache.h"
+
+#ifndef Q_NULLPTR
+#define Q_NULLPTR NULL
+#endif // Q_NULLPTR
+
+namespace pdf_viewer {
+
+/*!
+ * \struct RenderJob
+ * \brief Describes a single rasterization request handed to a RenderPool.
+ * All coordinates are expressed in scaled page space, i.e. in pixels of the page
+ * as it would appear when being rendered as a whole at the given scale and orientation.
+ */
+struct RenderJob
+{
+    /*!
+     * \brief What the rendered image is meant for.
+     */
+    enum Target {
+        FRAMEBUFFER,            //!< The image is a tile composited into the viewer's framebuffer
+        WHOLE_PAGE,             //!< The image is the whole page, used for page slides and prefetching
+        THUMBNAIL               //!< The image is a low resolution overview of the whole page
+    };
+
+    /*!
+     * \brief How urgently a job is needed. Jobs of higher priority are processed first.
+     */
+    enum Priority {
+        BACKGROUND,             //!< Speculative work, like prefetching pages the user may visit next
+        INTERACTIVE,            //!< Content the user is waiting for
+        PREVIEW                 //!< Coarse stand-in for content which has missed its deadline
+    };
+
+    RenderJob();
+
+    TileKey key;                //!< Key the rendered image is cached under, also carrying the render hints
+    int pageNumber;             //!< Zero based page number
+    qreal scale;                //!< Scale relative to 72 DPI
+    int orientation;            //!< Page orientation, numerically equal to Poppler::Page::Rotation
+    QRect rect;                 //!< Area of the scaled page to render
+    Target target;              //!< Purpose of the rendered image
+    Priority priority;          //!< Urgency of the job
+    void const *owner;          //!< Requester, whose obsolete jobs are dropped by RenderPool::cancel()
+    int generation;             //!< View state generation of the requester at the time of the request
+    qint64 deadline;            //!< Time as of RenderStats::now() the image is needed by, -1 if there is no hurry
+
+    qint64 renderStart;         //!< Set by the worker: start of rasterization as of RenderStats::now(), -1 if loaded from disk
+    qint64 renderDuration;      //!< Set by the worker: microseconds spent in rasterization
+    int worker;                 //!< Set by the worker: index of the worker thread within the pool
+};
+
+class RenderWorker;
+
+/*!
+ * \class RenderPool
+ * \brief A pool of background threads rasterizing PDF pages through Poppler.
+ *
+ * Poppler documents must not be shared across threads, so every worker thread owns its very
+ * own document handle, opened on the same source. Jobs are queued from the GUI thread into a
+ * single queue and processed by priority, and by earliest deadline within the same priority, by whichever worker is free,
+ * so the tiles of a viewport are rendered concurrently on all cores. Jobs which have become obsolete before being started
+ * are dropped by cancel(). Poppler's Qt4 binding offers no way to abort a rasterization, so a job already started
+ * is always finished, which is why jobs are kept as small as tiles wherever possible. Documents are opened by the workers as soon as the first job
+ * actually needs to be rasterized, so images found in the disk cache are delivered even before that.
+ * Each finished image is converted to the framebuffer format and delivered back through the
+ * rendered() signal, which is received as a queued signal by objects living in the GUI thread.
+ */
+class RenderPool : public QObject
+{
+
+    Q_OBJECT
+
+public:
+
+    /*!
+     * \brief Construct the pool and start its worker threads.
+     * \param threadCount Number of worker threads, by default one per core.
+     */
+    explicit RenderPool(int const threadCount = QThread::idealThreadCount(), QObject * const parent = Q_NULLPTR);
+
+    /*!
+     * \brief Destructs the pool, whose workers must have finished, which is why it is only ever deleted through detach().
+     */
+    virtual ~RenderPool();
+
+    /*!
+     * \brief Discards all pending jobs and stops the workers, the pool then deletes itself once the last one has finished.
+     * A rasterization in progress cannot be aborted, so whoever drops the pool does not have to wait for it.
+     */
+    void detach();
+
+    /*!
+     * \brief Sets the document to render, which workers open once they need it. All pending jobs are discarded.
+     * \param source Document file path.
+     */
+    void setSource(QString const &source);
+
+    /*!
+     * \brief Sets a persistent cache which is looked up before rendering, and which every rendered image is stored in.
+     * \param diskCache The cache, or a null pointer to disable it.
+     * \param documentHash Hash of the document's content, identifying its images within the cache.
+     */
+    void setDiskCache(QSharedPointer<DiskCache> const &diskCache, QString const &documentHash);
+
+    /*!
+     * \brief Queues a job behind all jobs of higher priority, and of the same priority and an earlier or no later deadline.
+     */
+    void enqueue(RenderJob const &job);
+
+    /*!
+     * \brief Raises the priority and deadline of a queued job to those of another request for the same key, if more urgent.
+     * Jobs already started or delivered are left alone.
+     */
+    void promote(RenderJob const &job);
+
+    /*!
+     * \brief Drops the queued jobs of a requester which are older than the given view state generation.
+     * \return The dropped jobs, which will never be delivered.
+     */
+    QList<RenderJob> cancel(void const * const owner, int const generation);
+
+    /*!
+     * \brief Discards all jobs that have not been started yet.
+     */
+    void clear();
+
+signals:
+
+    /*!
+     * \brief Emitted from within a worker thread as soon as a job has been rendered.
+     * Every job taken from the queue is delivered, with a null image if its document or page could not be opened.
+     */
+    void rendered(pdf_viewer::RenderJob job, QImage image);
+
+private slots:
+
+    void releaseWorker();
+
+private:
+
+    friend class RenderWorker;
+
+    QImage deliver(RenderJob const &job, QImage const &image);
+    static bool isMoreUrgent(RenderJob const &job, RenderJob const &other);
+
+    QList<RenderWorker *> mWorkers;
+
+    QMutex mMutex;
+    QWaitCondition mCondition;
+    QList<RenderJob> mJobs;
+    QString mSource;
+    int mSourceSerial;
+    QSharedPointer<DiskCache> mDiskCache;
+    QString mDocumentHash;
+    bool mQuit;
+    int mFinishedWorkers;
+
+};
+
+/*!
+ * \class RenderWorker
+ * \brief A single worker thread of a RenderPool.
+ */
+class RenderWorker : public QThread
+{
+
+public:
+
+    RenderWorker(RenderPool * const pool, int const index);
+
+protected:
+
+    virtual void run();
+
+private:
+
+    RenderPool * const mPool;
+    int const mIndex;
+
+};
+
+} // namespace pdf_viewer
+
+Q_DECLARE_METATYPE(pdf_viewer::RenderJob)
+
+#endif // RENDERPOOL_H
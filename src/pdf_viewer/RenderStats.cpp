@@ -0,0 +1,369 @@
+#include "RenderStats.h"
+
+#include <QElapsedTimer>
+#include <QTimer>
+
+namespace pdf_viewer {
+
+namespace {
+
+// Common time base of all spans, started along with the process:
+QElapsedTimer
+startedClock()
+{
+    QElapsedTimer clock;
+    clock.start();
+    return clock;
+}
+
+QElapsedTimer const CLOCK = startedClock();
+
+// Trace thread ids, the render threads follow the GUI thread:
+const int GUI_THREAD = 0;
+
+} // namespace
+
+const int RenderStats::CHANGED_INTERVAL = 250;
+
+RenderStats::RenderStats(
+        QObject * const parent
+)
+    : QObject(parent)
+    , mRenderCount(0)
+    , mPixelsRasterized(0)
+    , mRenderTime(0)
+    , mDiskCacheHits(0)
+    , mPaintCount(0)
+    , mPaintTime(0)
+    , mCacheHits(0)
+    , mCacheMisses(0)
+    , mDroppedFrames(0)
+    , mAnimationFrameCount(0)
+    , mFrameTime(0)
+    , mMaxFrameTime(0)
+    , mBytesCopied(0)
+    , mPanCount(0)
+    , mCancelledJobs(0)
+    , mMissedDeadlines(0)
+    , mChangedTimer(new QTimer(this))
+    , mTraceEmpty(true)
+{
+    // Counters change with every paint, so bindings are only notified a few times per second:
+    mChangedTimer->setSingleShot(true);
+    mChangedTimer->setInterval(CHANGED_INTERVAL);
+    connect(mChangedTimer, SIGNAL(timeout()), this, SIGNAL(changed()));
+}
+
+RenderStats::~RenderStats()
+{
+    setTraceFile(QString());
+}
+
+void
+RenderStats::reset()
+{
+    mRenderCount = 0;
+    mPixelsRasterized = 0;
+    mRenderTime = 0;
+    mDiskCacheHits = 0;
+    mPaintCount = 0;
+    mPaintTime = 0;
+    mCacheHits = 0;
+    mCacheMisses = 0;
+    mDroppedFrames = 0;
+    mAnimationFrameCount = 0;
+    mFrameTime = 0;
+    mMaxFrameTime = 0;
+    mBytesCopied = 0;
+    mPanCount = 0;
+    mCancelledJobs = 0;
+    mMissedDeadlines = 0;
+    emit changed();
+}
+
+int
+RenderStats::renderCount() const
+{
+    return mRenderCount;
+}
+
+qreal
+RenderStats::pixelsRasterized() const
+{
+    return mPixelsRasterized;
+}
+
+qreal
+RenderStats::renderTime() const
+{
+    return mRenderTime / 1000.0;
+}
+
+int
+RenderStats::diskCacheHits() const
+{
+    return mDiskCacheHits;
+}
+
+int
+RenderStats::paintCount() const
+{
+    return mPaintCount;
+}
+
+qreal
+RenderStats::paintTime() const
+{
+    return mPaintTime / 1000.0;
+}
+
+int
+RenderStats::cacheHits() const
+{
+    return mCacheHits;
+}
+
+int
+RenderStats::cacheMisses() const
+{
+    return mCacheMisses;
+}
+
+int
+RenderStats::droppedFrames() const
+{
+    return mDroppedFrames;
+}
+
+int
+RenderStats::animationFrameCount() const
+{
+    return mAnimationFrameCount;
+}
+
+qreal
+RenderStats::averageFrameTime() const
+{
+    return mAnimationFrameCount > 0 ? mFrameTime / 1000.0 / mAnimationFrameCount : 0;
+}
+
+qreal
+RenderStats::maxFrameTime() const
+{
+    return mMaxFrameTime / 1000.0;
+}
+
+qreal
+RenderStats::bytesCopied() const
+{
+    return mBytesCopied;
+}
+
+int
+RenderStats::panCount() const
+{
+    return mPanCount;
+}
+
+int
+RenderStats::cancelledJobs() const
+{
+    return mCancelledJobs;
+}
+
+int
+RenderStats::missedDeadlines() const
+{
+    return mMissedDeadlines;
+}
+
+void
+RenderStats::setTraceFile(
+        QString const &path
+)
+{
+    if(path == traceFile())
+    {
+        return;
+    }
+
+    // Terminate the previous trace, although trace viewers would also accept an unterminated one:
+    if(mTraceFile.isOpen())
+    {
+        mTraceFile.write("\n]\n");
+        mTraceFile.close();
+    }
+    mTraceFile.setFileName(path);
+    mTraceEmpty = true;
+    mTracedThreads.clear();
+
+    if(!path.isEmpty())
+    {
+        if(mTraceFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        {
+            mTraceFile.write("[\n");
+        }
+        else
+        {
+            mTraceFile.setFileName(QString());
+        }
+    }
+}
+
+QString
+RenderStats::traceFile() const
+{
+    return mTraceFile.fileName();
+}
+
+qint64
+RenderStats::now()
+{
+    return CLOCK.nsecsElapsed() / 1000;
+}
+
+void
+RenderStats::addRender(
+        qint64 const pixels,
+        qint64 const start,
+        qint64 const duration,
+        int const worker
+)
+{
+    if(start < 0)
+    {
+        mDiskCacheHits++;
+    }
+    else
+    {
+        mRenderCount++;
+        mPixelsRasterized += pixels;
+        mRenderTime += duration;
+        writeTraceEvent("renderToImage", start, duration, GUI_THREAD + 1 + worker, QString("{\"pixels\":%1}").arg(pixels));
+    }
+    scheduleChanged();
+}
+
+void
+RenderStats::addPaint(
+        qint64 const start
+)
+{
+    qint64 const duration = now() - start;
+    mPaintCount++;
+    mPaintTime += duration;
+    writeTraceEvent("paint", start, duration, GUI_THREAD, QString());
+    scheduleChanged();
+}
+
+void
+RenderStats::addCacheLookup(
+        bool const hit
+)
+{
+    (hit ? mCacheHits : mCacheMisses)++;
+    scheduleChanged();
+}
+
+void
+RenderStats::addAnimationFrame(
+        qint64 const interval,
+        qint64 const expectedInterval
+)
+{
+    // A frame shown after two intervals means that one frame has been skipped, and so on:
+    int const dropped = qMax(0, static_cast<int>((interval + expectedInterval / 2) / expectedInterval) - 1);
+    mDroppedFrames += dropped;
+    mAnimationFrameCount++;
+    mFrameTime += interval;
+    mMaxFrameTime = qMax(mMaxFrameTime, interval);
+    writeTraceEvent("animationFrame", now() - interval, interval, GUI_THREAD, QString("{\"dropped\":%1}").arg(dropped));
+    scheduleChanged();
+}
+
+void
+RenderStats::addBytesCopied(
+        qint64 const bytes
+)
+{
+    mBytesCopied += bytes;
+    scheduleChanged();
+}
+
+void
+RenderStats::addPan()
+{
+    mPanCount++;
+    scheduleChanged();
+}
+
+void
+RenderStats::addCancelledJob()
+{
+    mCancelledJobs++;
+    scheduleChanged();
+}
+
+void
+RenderStats::addMissedDeadline()
+{
+    mMissedDeadlines++;
+    scheduleChanged();
+}
+
+void
+RenderStats::addSpan(
+        char const * const name,
+        qint64 const start
+)
+{
+    writeTraceEvent(name, start, now() - start, GUI_THREAD, QString());
+}
+
+void
+RenderStats::scheduleChanged()
+{
+    if(!mChangedTimer->isActive())
+    {
+        mChangedTimer->start();
+    }
+}
+
+void
+RenderStats::writeTraceEvent(
+        QString const &name,
+        qint64 const start,
+        qint64 const duration,
+        int const thread,
+        QString const &arguments
+)
+{
+    if(!mTraceFile.isOpen())
+    {
+        return;
+    }
+
+    // Threads are named by a metadata event before their first span:
+    QString events;
+    if(!mTracedThreads.contains(thread))
+    {
+        mTracedThreads.insert(thread);
+        QString const threadName = GUI_THREAD == thread ? QString("GUI") : QString("Render %1").arg(thread - GUI_THREAD - 1);
+        events += QString("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%1,\"args\":{\"name\":\"%2\"}},\n")
+                .arg(thread)
+                .arg(threadName);
+    }
+
+    // Complete events carry their start and duration in microseconds:
+    events += QString("{\"name\":\"%1\",\"ph\":\"X\",\"pid\":1,\"tid\":%2,\"ts\":%3,\"dur\":%4%5}")
+            .arg(name)
+            .arg(thread)
+            .arg(start)
+            .arg(duration)
+            .arg(arguments.isEmpty() ? QString() : ",\"args\":" + arguments);
+
+    mTraceFile.write((mTraceEmpty ? events : ",\n" + events).toUtf8());
+    mTraceEmpty = false;
+}
+
+} // namespace pdf_viewer
@@ -0,0 +1,252 @@
+#ifndef RENDERSTATS_H
+#define RENDERSTATS_H
+
+#include <QObject>
+#include <QFile>
+#include <QSet>
+#include <QString>
+
+#ifndef Q_NULLPTR
+#define Q_NULLPTR NULL
+#endif // Q_NULLPTR
+
+class QTimer;
+
+namespace pdf_viewer {
+
+/*!
+ * \class RenderStats
+ * \brief Counters of the work done by a single viewer to get pixels onto the screen.
+ *
+ * The counters are read-only to QML and are accumulated from the moment the viewer has been created,
+ * or since reset() has been called. Change notifications are throttled, so bindings to the counters
+ * do not cost a frame themselves.
+ *
+ * Optionally, spans of all rasterizations, paints, framebuffer renders and animation frames are written
+ * to a trace file in the Chrome trace event format, which can be loaded into `chrome://tracing` or Perfetto.
+ */
+class RenderStats : public QObject
+{
+
+    Q_OBJECT
+
+public:
+
+    /*!
+     * \brief Number of tiles and pages rasterized by Poppler for the viewer.
+     */
+    Q_PROPERTY(int renderCount READ renderCount NOTIFY changed)
+
+    /*!
+     * \brief Number of pixels rasterized by Poppler for the viewer.
+     * Given as real number, as it easily exceeds the integer range.
+     */
+    Q_PROPERTY(qreal pixelsRasterized READ pixelsRasterized NOTIFY changed)
+
+    /*!
+     * \brief Milliseconds spent by the render threads in rasterization for the viewer, summed up over all threads.
+     */
+    Q_PROPERTY(qreal renderTime READ renderTime NOTIFY changed)
+
+    /*!
+     * \brief Number of images loaded from the persistent cache instead of being rasterized.
+     */
+    Q_PROPERTY(int diskCacheHits READ diskCacheHits NOTIFY changed)
+
+    /*!
+     * \brief Number of paints of the viewer.
+     */
+    Q_PROPERTY(int paintCount READ paintCount NOTIFY changed)
+
+    /*!
+     * \brief Milliseconds spent in painting the viewer, including the framebuffer renders done meanwhile.
+     */
+    Q_PROPERTY(qreal paintTime READ paintTime NOTIFY changed)
+
+    /*!
+     * \brief Number of tiles and pages found in the tile cache when composing the framebuffer.
+     */
+    Q_PROPERTY(int cacheHits READ cacheHits NOTIFY changed)
+
+    /*!
+     * \brief Number of tiles that had to be requested from the render threads when composing the framebuffer.
+     */
+    Q_PROPERTY(int cacheMisses READ cacheMisses NOTIFY changed)
+
+    /*!
+     * \brief Number of animation frames that have been shown late enough to skip at least one frame.
+     */
+    Q_PROPERTY(int droppedFrames READ droppedFrames NOTIFY changed)
+
+    /*!
+     * \brief Number of animation frames shown.
+     */
+    Q_PROPERTY(int animationFrameCount READ animationFrameCount NOTIFY changed)
+
+    /*!
+     * \brief Average milliseconds between two animation frames.
+     */
+    Q_PROPERTY(qreal averageFrameTime READ averageFrameTime NOTIFY changed)
+
+    /*!
+     * \brief Longest time between two animation frames in milliseconds.
+     */
+    Q_PROPERTY(qreal maxFrameTime READ maxFrameTime NOTIFY changed)
+
+    /*!
+     * \brief Bytes moved by the GUI thread into, within and out of the framebuffer, including its uploads to the screen.
+     * Given as real number, as it easily exceeds the integer range.
+     */
+    Q_PROPERTY(qreal bytesCopied READ bytesCopied NOTIFY changed)
+
+    /*!
+     * \brief Number of pans, by dragging, flicking or programmatically.
+     * Divide the increase of bytesCopied by the increase of panCount during a pan sequence to get the bytes copied per pan.
+     */
+    Q_PROPERTY(int panCount READ panCount NOTIFY changed)
+
+    /*!
+     * \brief Number of render jobs dropped before being started, as the view state they were requested for had been left.
+     */
+    Q_PROPERTY(int cancelledJobs READ cancelledJobs NOTIFY changed)
+
+    /*!
+     * \brief Number of times visible tiles have not arrived by their deadline, so a coarse preview has been requested.
+     */
+    Q_PROPERTY(int missedDeadlines READ missedDeadlines NOTIFY changed)
+
+    /*!
+     * \brief Resets all counters to zero.
+     */
+    Q_INVOKABLE void reset();
+
+    explicit RenderStats(QObject * const parent = Q_NULLPTR);
+
+    virtual ~RenderStats();
+
+    int renderCount() const;
+    qreal pixelsRasterized() const;
+    qreal renderTime() const;
+    int diskCacheHits() const;
+    int paintCount() const;
+    qreal paintTime() const;
+    int cacheHits() const;
+    int cacheMisses() const;
+    int droppedFrames() const;
+    int animationFrameCount() const;
+    qreal averageFrameTime() const;
+    qreal maxFrameTime() const;
+    qreal bytesCopied() const;
+    int panCount() const;
+    int cancelledJobs() const;
+    int missedDeadlines() const;
+
+    /*!
+     * \brief Starts writing a trace file, replacing any previous one, or stops tracing.
+     * \param path File path, or an empty string to stop tracing.
+     */
+    void setTraceFile(QString const &path);
+
+    /*!
+     * \brief The current trace file, which is empty if not tracing.
+     */
+    QString traceFile() const;
+
+    /*!
+     * \brief Microseconds since the start of the process, the common time base of all spans.
+     * May be called from any thread.
+     */
+    static qint64 now();
+
+    /*!
+     * \brief Counts an image delivered by the render pool.
+     * \param pixels Number of pixels rasterized.
+     * \param start Start of the rasterization, as returned by now(), or -1 if the image has been loaded from disk.
+     * \param duration Duration of the rasterization in microseconds.
+     * \param worker Index of the render thread.
+     */
+    void addRender(qint64 const pixels, qint64 const start, qint64 const duration, int const worker);
+
+    /*!
+     * \brief Counts a paint of the viewer, which started at the given time and lasted until now.
+     */
+    void addPaint(qint64 const start);
+
+    /*!
+     * \brief Counts a lookup within the tile cache.
+     */
+    void addCacheLookup(bool const hit);
+
+    /*!
+     * \brief Counts an animation frame and the frames dropped before it.
+     * \param interval Microseconds since the previous frame.
+     * \param expectedInterval Microseconds between two frames at the intended frame rate.
+     */
+    void addAnimationFrame(qint64 const interval, qint64 const expectedInterval);
+
+    /*!
+     * \brief Counts bytes copied into, within or out of the framebuffer.
+     */
+    void addBytesCopied(qint64 const bytes);
+
+    /*!
+     * \brief Counts a pan of the viewer.
+     */
+    void addPan();
+
+    /*!
+     * \brief Counts a render job dropped before being started.
+     */
+    void addCancelledJob();
+
+    /*!
+     * \brief Counts a deadline missed by the visible tiles.
+     */
+    void addMissedDeadline();
+
+    /*!
+     * \brief Writes a span of the GUI thread into the trace file, if tracing.
+     * \param name Name of the span.
+     * \param start Start of the span, as returned by now(); it lasts until now.
+     */
+    void addSpan(char const * const name, qint64 const start);
+
+signals:
+
+    void changed();
+
+private:
+
+    void scheduleChanged();
+    void writeTraceEvent(QString const &name, qint64 const start, qint64 const duration, int const thread, QString const &arguments);
+
+    int mRenderCount;
+    qint64 mPixelsRasterized;
+    qint64 mRenderTime;
+    int mDiskCacheHits;
+    int mPaintCount;
+    qint64 mPaintTime;
+    int mCacheHits;
+    int mCacheMisses;
+    int mDroppedFrames;
+    int mAnimationFrameCount;
+    qint64 mFrameTime;
+    qint64 mMaxFrameTime;
+    qint64 mBytesCopied;
+    int mPanCount;
+    int mCancelledJobs;
+    int mMissedDeadlines;
+
+    QTimer *mChangedTimer;
+
+    QFile mTraceFile;
+    bool mTraceEmpty;
+    QSet<int> mTracedThreads;
+
+    static const int CHANGED_INTERVAL;
+
+};
+
+} // namespace pdf_viewer
+
+#endif // RENDERSTATS_H
@@ -0,0 +1,445 @@
+#include "SharedDocument.h"
+
+#include <QTimer>
+
+#include <poppler/qt4/poppler-qt4.h>
+
+namespace pdf_viewer {
+
+SharedDocument::SharedDocument(
+        QString const &path
+)
+    : QObject()
+    , mPath(path)
+    , mLoader(new DocumentLoader(path))
+    , mHasher(Q_NULLPTR)
+    , mDocument(Q_NULLPTR)
+    , mRenderTime(0)
+    , mPixelsRendered(0)
+    , mRenderPool(new RenderPool(QThread::idealThreadCount(), this))
+    , mTextIndex(Q_NULLPTR)
+    , mTileCache(64 * 1024 * 1024)
+    , mThumbnailCache(32 * 1024 * 1024)
+{
+    connect(mLoader, SIGNAL(contentHashed()), this, SLOT(takeContentHash()));
+    connect(mLoader, SIGNAL(finished()), this, SLOT(takeLoadedDocument()));
+
+    // Loading starts once back in the event loop, so a disk cache set right after acquiring the document
+    // is known before parsing, and the content can be hashed ahead of it:
+    QTimer::singleShot(0, mLoader, SLOT(start()));
+
+    connect(mRenderPool, SIGNAL(rendered(pdf_viewer::RenderJob,QImage)), this, SLOT(cacheRenderedImage(pdf_viewer::RenderJob,QImage)));
+}
+
+SharedDocument::~SharedDocument()
+{
+    // A loader still running is not waited for, it deletes itself once Poppler has finished parsing:
+    if(mLoader)
+    {
+        disconnect(mLoader, Q_NULLPTR, this, Q_NULLPTR);
+        mLoader->cancel();
+        connect(mLoader, SIGNAL(finished()), mLoader, SLOT(deleteLater()));
+        if(mLoader->isFinished())
+        {
+            mLoader->deleteLater();
+        }
+    }
+
+    if(mHasher)
+    {
+        disconnect(mHasher, Q_NULLPTR, this, Q_NULLPTR);
+        connect(mHasher, SIGNAL(finished()), mHasher, SLOT(deleteLater()));
+        if(mHasher->isFinished())
+        {
+            mHasher->deleteLater();
+        }
+    }
+
+    // Rendering and indexing threads are not waited for either, as they cannot be interrupted within a page:
+    disconnect(mRenderPool, Q_NULLPTR, this, Q_NULLPTR);
+    mRenderPool->detach();
+    if(mTextIndex)
+    {
+        disconnect(mTextIndex, Q_NULLPTR, this, Q_NULLPTR);
+        mTextIndex->setParent(Q_NULLPTR);
+        mTextIndex->cancel();
+        connect(mTextIndex, SIGNAL(finished()), mTextIndex, SLOT(deleteLater()));
+        if(mTextIndex->isFinished())
+        {
+            mTextIndex->deleteLater();
+        }
+    }
+    delete mDocument;
+}
+
+bool
+SharedDocument::isLoading() const
+{
+    return Q_NULLPTR != mLoader;
+}
+
+Poppler::Document *
+SharedDocument::document() const
+{
+    return mDocument;
+}
+
+int
+SharedDocument::pageCount() const
+{
+    return mPageSizes.size();
+}
+
+QSize
+SharedDocument::pageSize(
+        int const pageNumber
+) const
+{
+    return mPageSizes.at(pageNumber);
+}
+
+qreal
+SharedDocument::pageRenderTime(
+        int const pageNumber
+) const
+{
+    return pageNumber >= 0 && pageNumber < mPageRenderTimes.size() ? mPageRenderTimes.at(pageNumber) / 1000.0 : 0;
+}
+
+qreal
+SharedDocument::pageRenderCost(
+        int const pageNumber
+) const
+{
+    if(pageNumber < 0 || pageNumber >= mPagePixelsRendered.size() || 0 == mPagePixelsRendered.at(pageNumber))
+    {
+        return -1;
+    }
+    return mPageRenderTimes.at(pageNumber) / 1000.0 / (mPagePixelsRendered.at(pageNumber) / 1000000.0);
+}
+
+qreal
+SharedDocument::averageRenderCost() const
+{
+    return mPixelsRendered > 0 ? mRenderTime / 1000.0 / (mPixelsRendered / 1000000.0) : -1;
+}
+
+TileCache &
+SharedDocument::tileCache()
+{
+    return mTileCache;
+}
+
+TileCache &
+SharedDocument::thumbnailCache()
+{
+    return mThumbnailCache;
+}
+
+void
+SharedDocument::setDiskCache(
+        QSharedPointer<DiskCache> const &diskCache
+)
+{
+    mDiskCache = diskCache;
+    if(diskCache && mContentHash.isEmpty())
+    {
+        hashContent();
+        return;
+    }
+    applyDiskCache();
+}
+
+void
+SharedDocument::hashContent()
+{
+    // Hashing reads the whole file, so it is done in the background, by the loader while still loading.
+    // The cache is applied once the hash is known:
+    if(mLoader)
+    {
+        mLoader->requestContentHash();
+        return;
+    }
+    if(!mHasher)
+    {
+        mHasher = new ContentHasher(mPath);
+        connect(mHasher, SIGNAL(finished()), this, SLOT(takeComputedContentHash()));
+        mHasher->start(QThread::LowPriority);
+    }
+}
+
+void
+SharedDocument::applyDiskCache()
+{
+    // A file which cannot be read or opened is not cached at all:
+    mRenderPool->setDiskCache(mContentHash.isEmpty() ? QSharedPointer<DiskCache>() : mDiskCache, mContentHash);
+
+    // The page geometry is kept along with the images once parsed, so the document can be shown right away when opened again:
+    if(mDiskCache && !mContentHash.isEmpty() && mDocument && !mPageSizes.isEmpty())
+    {
+        mDiskCache->storePageSizes(mContentHash, mPageSizes);
+    }
+}
+
+void
+SharedDocument::render(
+        RenderJob const &job
+)
+{
+    // The tile might already be on its way, possibly requested by another viewer with less urgency, e.g. as prefetch:
+    if(mPendingTiles.contains(job.key))
+    {
+        mRenderPool->promote(job);
+        return;
+    }
+    mPendingTiles.insert(job.key);
+    mRenderPool->enqueue(job);
+}
+
+void
+SharedDocument::cancel(
+        void const * const owner,
+        int const generation
+)
+{
+    QList<RenderJob> const cancelled = mRenderPool->cancel(owner, generation);
+    for(int i = 0; i < cancelled.size(); i++)
+    {
+        mPendingTiles.remove(cancelled.at(i).key);
+        emit this->cancelled(cancelled.at(i));
+    }
+}
+
+void
+SharedDocument::startTextIndex()
+{
+    if(!mTextIndex && !mPageSizes.isEmpty())
+    {
+        // Indexing competes with rendering for the processor, the latter being more urgent:
+        mTextIndex = new TextIndex(mPath, mPageSizes.size(), this);
+        connect(mTextIndex, SIGNAL(progressed()), this, SIGNAL(textIndexProgressed()));
+        mTextIndex->start(QThread::LowestPriority);
+    }
+}
+
+TextIndex *
+SharedDocument::textIndex() const
+{
+    return mTextIndex;
+}
+
+void
+SharedDocument::takeContentHash()
+{
+    mContentHash = mLoader->contentHash();
+    if(!mDiskCache || mContentHash.isEmpty())
+    {
+        return;
+    }
+
+    applyDiskCache();
+
+    // Pages recovered from the disk cache can be requested right away. Workers only parse the document
+    // for those not cached, each on its own:
+    QVector<QSize> const pageSizes = mDiskCache->loadPageSizes(mContentHash);
+    if(!pageSizes.isEmpty())
+    {
+        mPageSizes = pageSizes;
+        mPageRenderTimes.fill(0, mPageSizes.size());
+        mPagePixelsRendered.fill(0, mPageSizes.size());
+        mRenderPool->setSource(mPath);
+        emit pagesRecovered();
+    }
+}
+
+void
+SharedDocument::takeComputedContentHash()
+{
+    mContentHash = mHasher->contentHash();
+    mHasher->deleteLater();
+    mHasher = Q_NULLPTR;
+    applyDiskCache();
+}
+
+void
+SharedDocument::takeLoadedDocument()
+{
+    bool const pagesRecovered = !mPageSizes.isEmpty();
+    mDocument = mLoader->takeDocument();
+    mPageSizes = mLoader->pageSizes();
+    mContentHash = mLoader->contentHash();
+    mLoader->deleteLater();
+    mLoader = Q_NULLPTR;
+
+    // Costs measured on recovered pages meanwhile are kept:
+    if(mPageRenderTimes.size() != mPageSizes.size())
+    {
+        mPageRenderTimes.fill(0, mPageSizes.size());
+        mPagePixelsRendered.fill(0, mPageSizes.size());
+    }
+
+    // Each render worker opens its own handle, as Poppler documents cannot be shared across threads.
+    // The source has already been set along with recovered pages, setting it again would drop their jobs:
+    if(mDocument && !mDocument->isLocked())
+    {
+        if(!pagesRecovered)
+        {
+            mRenderPool->setSource(mPath);
+        }
+        applyDiskCache();
+
+        // A hash asked for too late for the loader to take care of is computed now:
+        if(mDiskCache && mContentHash.isEmpty())
+        {
+            hashContent();
+        }
+    }
+
+    emit loaded();
+}
+
+void
+SharedDocument::cacheRenderedImage(
+        RenderJob const &job,
+        QImage const &image
+)
+{
+    mPendingTiles.remove(job.key);
+    if(!image.isNull())
+    {
+        (RenderJob::THUMBNAIL == job.target ? mThumbnailCache : mTileCache).insert(job.key, image);
+    }
+
+    // Thumbnails are left out of the page costs, as the fixed overhead of every rasterization dominates at their size:
+    if(job.renderStart >= 0 && RenderJob::THUMBNAIL != job.target && job.pageNumber < mPageRenderTimes.size())
+    {
+        qint64 const pixels = static_cast<qint64>(job.rect.width()) * job.rect.height();
+        mPageRenderTimes[job.pageNumber] += job.renderDuration;
+        mPagePixelsRendered[job.pageNumber] += pixels;
+        mRenderTime += job.renderDuration;
+        mPixelsRendered += pixels;
+        emit renderCostMeasured(job.pageNumber);
+    }
+
+    emit rendered(job, image);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////////////////////        Document loader
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+DocumentLoader::DocumentLoader(
+        QString const &path
+)
+    : QThread()
+    , mPath(path)
+    , mCancelled(0)
+    , mContentHashRequested(0)
+    , mDocument(Q_NULLPTR)
+{
+}
+
+DocumentLoader::~DocumentLoader()
+{
+    // A document which has not been taken has been cancelled:
+    wait();
+    delete mDocument;
+}
+
+void
+DocumentLoader::cancel()
+{
+    mCancelled.fetchAndStoreOrdered(1);
+}
+
+void
+DocumentLoader::requestContentHash()
+{
+    mContentHashRequested.fetchAndStoreOrdered(1);
+}
+
+Poppler::Document *
+DocumentLoader::takeDocument()
+{
+    Poppler::Document * const document = mDocument;
+    mDocument = Q_NULLPTR;
+    return document;
+}
+
+QVector<QSize>
+DocumentLoader::pageSizes() const
+{
+    return mPageSizes;
+}
+
+QString
+DocumentLoader::contentHash() const
+{
+    return mContentHash;
+}
+
+void
+DocumentLoader::run()
+{
+    // A loader cancelled before it has even started skips parsing as well:
+    if(0 != static_cast<int>(mCancelled))
+    {
+        return;
+    }
+
+    // Hash ahead of parsing if asked to by then, so cached pages can be shown while Poppler is busy:
+    bool hashed = false;
+    if(0 != static_cast<int>(mContentHashRequested) && 0 == static_cast<int>(mCancelled))
+    {
+        mContentHash = DiskCache::documentHash(mPath);
+        hashed = true;
+        emit contentHashed();
+    }
+
+    mDocument = Poppler::Document::load(mPath);
+    if(!mDocument || mDocument->isLocked() || 0 != static_cast<int>(mCancelled))
+    {
+        return;
+    }
+
+    // Read the page geometry once, so nobody has to instantiate pages just to know their size:
+    mPageSizes.resize(mDocument->numPages());
+    for(int i = 0; i < mPageSizes.size() && 0 == static_cast<int>(mCancelled); i++)
+    {
+        Poppler::Page const * const page = mDocument->page(i);
+        mPageSizes[i] = page ? page->pageSize() : QSize();
+        delete page;
+    }
+
+    // A hash asked for during parsing is only computed now:
+    if(!hashed && 0 != static_cast<int>(mContentHashRequested) && 0 == static_cast<int>(mCancelled))
+    {
+        mContentHash = DiskCache::documentHash(mPath);
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////////////////////        Content hasher
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+ContentHasher::ContentHasher(
+        QString const &path
+)
+    : QThread()
+    , mPath(path)
+{
+}
+
+QString
+ContentHasher::contentHash() const
+{
+    return mContentHash;
+}
+
+void
+ContentHasher::run()
+{
+    mContentHash = DiskCache::documentHash(mPath);
+}
+
+} // namespace pdf_viewer
@@ -0,0 +1,296 @@
+#ifndef SHAREDDOCUMENT_H
+#define SHAREDDOCUMENT_H
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QSet>
+#include <QSize>
+#include <QVector>
+
+#include "DiskCache.h"
+#include "RenderPool.h"
+#include "TextIndex.h"
+#include "TileCache.h"
+
+#ifndef Q_NULLPTR
+#define Q_NULLPTR NULL
+#endif // Q_NULLPTR
+
+namespace Poppler {
+    class Document;
+}
+
+namespace pdf_viewer {
+
+class ContentHasher;
+class DocumentLoader;
+
+/*!
+ * \class SharedDocument
+ * \brief A document opened once and shared by all viewers showing it.
+ *
+ * Besides the parsed Poppler document, the shared document holds everything that does not depend on
+ * a particular viewer: the page geometry, the render pool with its per-thread document handles, the text index
+ * and the caches of rendered tiles and thumbnails. Tiles requested by one viewer can therefore be reused by all others.
+ * Shared documents are handed out by the DocumentRegistry.
+ *
+ * Documents are opened within a background thread, as parsing large files or reading them from a slow disk
+ * takes a while. Until loaded() has been emitted, the document behaves as if it had no pages, unless
+ * its page geometry has been recovered from the disk cache before, as announced through pagesRecovered().
+ * Cached tiles can then be shown while Poppler is still parsing.
+ */
+class SharedDocument : public QObject
+{
+
+    Q_OBJECT
+
+public:
+
+    /*!
+     * \brief Starts to open a document in the background.
+     * \param path Document file path.
+     */
+    explicit SharedDocument(QString const &path);
+
+    virtual ~SharedDocument();
+
+    /*!
+     * \brief Whether the document is still being opened.
+     */
+    bool isLoading() const;
+
+    /*!
+     * \brief The Poppler document, to be used from within the GUI thread only.
+     * \return The document, or Q_NULLPTR if it could not be opened or is still loading.
+     */
+    Poppler::Document *document() const;
+
+    /*!
+     * \brief Number of pages, read once at open, or recovered from the disk cache.
+     */
+    int pageCount() const;
+
+    /*!
+     * \brief Size of a page in points, not taking any orientation into account, read once at open.
+     */
+    QSize pageSize(int const pageNumber) const;
+
+    /*!
+     * \brief Milliseconds spent in rasterizing a page so far, for all viewers, thumbnails aside.
+     */
+    qreal pageRenderTime(int const pageNumber) const;
+
+    /*!
+     * \brief Measured cost of rasterizing a page, in milliseconds per megapixel.
+     * The cost varies widely between pages, from plain text to scans and dense vector drawings.
+     * \return The cost, or -1 if the page has not been rasterized yet.
+     */
+    qreal pageRenderCost(int const pageNumber) const;
+
+    /*!
+     * \brief Measured cost of rasterizing all pages rendered so far, in milliseconds per megapixel.
+     * Serves as estimate for pages not rasterized yet, as pages of a document tend to be alike.
+     * \return The cost, or -1 if no page has been rasterized yet.
+     */
+    qreal averageRenderCost() const;
+
+    /*!
+     * \brief Rendered tiles of this document.
+     */
+    TileCache &tileCache();
+
+    /*!
+     * \brief Rendered page thumbnails of this document.
+     * They are kept apart from the tiles, so browsing pages at high zoom does not evict them.
+     */
+    TileCache &thumbnailCache();
+
+    /*!
+     * \brief Sets a persistent cache for the rendered images, the cache set last applies.
+     * The document's content is hashed once the first cache is set, in the background, ahead of parsing if still loading.
+     * \param diskCache The cache, or a null pointer to disable it.
+     */
+    void setDiskCache(QSharedPointer<DiskCache> const &diskCache);
+
+    /*!
+     * \brief Renders a job in the background, unless its tile is already on its way, which is then promoted to the job's urgency.
+     * The result is cached, as a thumbnail if it is one, and then announced through rendered().
+     */
+    void render(RenderJob const &job);
+
+    /*!
+     * \brief Drops the jobs of a requester which are older than the given view state generation and have not been started yet.
+     * Each dropped job is announced through cancelled(), so other requesters waiting for the same tile may request it again.
+     */
+    void cancel(void const * const owner, int const generation);
+
+    /*!
+     * \brief Starts indexing the text of this document in the background, unless already started.
+     * Indexing parses the document once more and extracts the text of every page, so it is only started once needed.
+     */
+    void startTextIndex();
+
+    /*!
+     * \brief The text index of this document.
+     * \return The index, or Q_NULLPTR if indexing has not been started or the document could not be opened.
+     */
+    TextIndex *textIndex() const;
+
+signals:
+
+    /*!
+     * \brief Emitted once the document has been opened, or has failed to open.
+     */
+    void loaded();
+
+    /*!
+     * \brief Emitted while still loading, once the page geometry has been recovered from the disk cache.
+     * From then on, pages can be requested, and those which have been cached are delivered without parsing.
+     */
+    void pagesRecovered();
+
+    /*!
+     * \brief Emitted within the GUI thread when a job has been rendered and cached.
+     * The image is null if the page could not be rasterized, which is not cached.
+     */
+    void rendered(pdf_viewer::RenderJob job, QImage image);
+
+    /*!
+     * \brief Emitted within the GUI thread when a job has been dropped before being rendered.
+     */
+    void cancelled(pdf_viewer::RenderJob job);
+
+    /*!
+     * \brief Emitted within the GUI thread whenever another rasterization of a page has been measured.
+     */
+    void renderCostMeasured(int pageNumber);
+
+    /*!
+     * \brief Emitted within the GUI thread whenever some more pages have been added to the text index.
+     */
+    void textIndexProgressed();
+
+private slots:
+
+    void takeContentHash();
+    void takeComputedContentHash();
+    void takeLoadedDocument();
+    void cacheRenderedImage(pdf_viewer::RenderJob const &job, QImage const &image);
+
+private:
+
+    void hashContent();
+    void applyDiskCache();
+
+    QString const mPath;
+    QString mContentHash;
+    QSharedPointer<DiskCache> mDiskCache;
+    DocumentLoader *mLoader;
+    ContentHasher *mHasher;
+    Poppler::Document *mDocument;
+    QVector<QSize> mPageSizes;
+    QVector<qint64> mPageRenderTimes;
+    QVector<qint64> mPagePixelsRendered;
+    qint64 mRenderTime;
+    qint64 mPixelsRendered;
+    RenderPool *mRenderPool;
+    TextIndex *mTextIndex;
+    TileCache mTileCache;
+    TileCache mThumbnailCache;
+    QSet<TileKey> mPendingTiles;
+
+};
+
+/*!
+ * \class DocumentLoader
+ * \brief Thread opening a document for a SharedDocument and reading its page geometry.
+ *
+ * If the document's content is to be hashed for the disk cache, that is done first and announced through
+ * contentHashed(), so cached pages can be looked up while the document is parsed.
+ * Poppler cannot be interrupted while parsing, so a cancelled loader keeps running until the document has
+ * been parsed, but skips everything after that. Cancelled loaders are left to delete themselves once finished,
+ * so nobody has to wait for them.
+ */
+class DocumentLoader : public QThread
+{
+
+    Q_OBJECT
+
+public:
+
+    explicit DocumentLoader(QString const &path);
+
+    virtual ~DocumentLoader();
+
+    /*!
+     * \brief Asks the loader to skip any remaining work. Its document is then discarded.
+     */
+    void cancel();
+
+    /*!
+     * \brief Asks the loader to also hash the document's content, ahead of parsing if it has not started that yet.
+     */
+    void requestContentHash();
+
+    /*!
+     * \brief Hands the document over to the caller, once the thread has finished.
+     */
+    Poppler::Document *takeDocument();
+
+    QVector<QSize> pageSizes() const;
+    QString contentHash() const;
+
+signals:
+
+    /*!
+     * \brief Emitted from within the loader thread once the content has been hashed, ahead of parsing.
+     */
+    void contentHashed();
+
+protected:
+
+    virtual void run();
+
+private:
+
+    QString const mPath;
+    QAtomicInt mCancelled;
+    QAtomicInt mContentHashRequested;
+    Poppler::Document *mDocument;
+    QVector<QSize> mPageSizes;
+    QString mContentHash;
+
+};
+
+/*!
+ * \class ContentHasher
+ * \brief Thread hashing a document's content for a SharedDocument whose DocumentLoader has already finished.
+ *
+ * Like the loader, a hasher dropped before it has finished is left to delete itself.
+ */
+class ContentHasher : public QThread
+{
+
+public:
+
+    explicit ContentHasher(QString const &path);
+
+    /*!
+     * \brief The hash, once the thread has finished, or an empty string if the file cannot be read.
+     */
+    QString contentHash() const;
+
+protected:
+
+    virtual void run();
+
+private:
+
+    QString const mPath;
+    QString mContentHash;
+
+};
+
+} // namespace pdf_viewer
+
+#endif // SHAREDDOCUMENT_H
@@ -0,0 +1,58 @@
+#include "SlideAnimation.h"
+
+namespace pdf_viewer {
+
+const int SlideAnimation::FRAME_INTERVAL = 16;
+
+SlideAnimation::SlideAnimation(
+        QObject * const parent
+)
+    : QAbstractAnimation(parent)
+    , mDuration(0)
+    , mFrame(0)
+{
+}
+
+void
+SlideAnimation::setCurve(
+        Polynomial const &curve,
+        int const duration
+)
+{
+    // One offset per frame, the last one being exactly at the end of the curve:
+    int const frameCount = duration / FRAME_INTERVAL + 1;
+    mOffsets.resize(frameCount + 1);
+    for(int i = 0; i < frameCount; i++)
+    {
+        mOffsets[i] = static_cast<int>(curve(i * FRAME_INTERVAL));
+    }
+    mOffsets[frameCount] = static_cast<int>(curve(duration));
+
+    mDuration = duration;
+    mFrame = 0;
+}
+
+int
+SlideAnimation::duration() const
+{
+    return mDuration;
+}
+
+void
+SlideAnimation::updateCurrentTime(
+        int currentTime
+)
+{
+    if(mOffsets.isEmpty())
+    {
+        return;
+    }
+
+    // Ticks do not exactly hit the frame times, the nearest frame is shown:
+    mFrame = currentTime >= mDuration
+            ? mOffsets.size() - 1
+            : qMin((currentTime + FRAME_INTERVAL / 2) / FRAME_INTERVAL, mOffsets.size() - 2);
+    emit frame(mOffsets.at(mFrame));
+}
+
+} // namespace pdf_viewer
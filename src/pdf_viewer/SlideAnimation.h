@@ -0,0 +1,67 @@
+#ifndef SLIDEANIMATION_H
+#define SLIDEANIMATION_H
+
+#include <QAbstractAnimation>
+#include <QVector>
+
+#include "Polynomial.h"
+
+#ifndef Q_NULLPTR
+#define Q_NULLPTR NULL
+#endif // Q_NULLPTR
+
+namespace pdf_viewer {
+
+/*!
+ * \class SlideAnimation
+ * \brief Animates a horizontal page offset along a Polynomial, paced by the display rate.
+ *
+ * The animation is driven by Qt's unified animation timer, which ticks all running animations at once
+ * at display rate. The curve is evaluated once per frame when the animation is set up, so a tick only
+ * costs a table lookup.
+ */
+class SlideAnimation : public QAbstractAnimation
+{
+
+    Q_OBJECT
+
+public:
+
+    explicit SlideAnimation(QObject * const parent = Q_NULLPTR);
+
+    /*!
+     * \brief Precomputes the offsets of all frames. Must not be called while running.
+     * \param curve Offset by milliseconds since start.
+     * \param duration Duration in milliseconds.
+     */
+    void setCurve(Polynomial const &curve, int const duration);
+
+    virtual int duration() const;
+
+    /*!
+     * \brief Interval between two frames in milliseconds, i.e. the interval of Qt's animation timer.
+     */
+    static const int FRAME_INTERVAL;
+
+signals:
+
+    /*!
+     * \brief Emitted on each tick, even if the offset has not changed since the last one.
+     */
+    void frame(int offset);
+
+protected:
+
+    virtual void updateCurrentTime(int currentTime);
+
+private:
+
+    QVector<int> mOffsets;
+    int mDuration;
+    int mFrame;
+
+};
+
+} // namespace pdf_viewer
+
+#endif // SLIDEANIMATION_H
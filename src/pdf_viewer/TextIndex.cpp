@@ -0,0 +1,229 @@
+#include "TextIndex.h"
+
+#include <QReadLocker>
+#include <QStringList>
+#include <QWriteLocker>
+
+#include <algorithm>
+
+#include <poppler/qt4/poppler-qt4.h>
+
+namespace pdf_viewer {
+
+namespace {
+
+// Progress is reported every this many pages, so listeners do not have to re-run queries for every single page:
+const int PROGRESS_INTERVAL = 16;
+
+} // namespace
+
+TextIndex::TextIndex(
+        QString const &path,
+        int const pageCount,
+        QObject * const parent
+)
+    : QThread(parent)
+    , mPath(path)
+    , mPageCount(pageCount)
+    , mQuit(0)
+    , mPageWords(pageCount)
+    , mPageBoxes(pageCount)
+    , mIndexedPageCount(0)
+{
+}
+
+TextIndex::~TextIndex()
+{
+    // A cancelled index is only deleted once its thread has finished:
+    wait();
+}
+
+void
+TextIndex::cancel()
+{
+    mQuit.fetchAndStoreOrdered(1);
+}
+
+int
+TextIndex::indexedPageCount() const
+{
+    QReadLocker locker(&mLock);
+    return mIndexedPageCount;
+}
+
+QString
+TextIndex::normalized(
+        QString const &word
+)
+{
+    int first = 0;
+    int last = word.size() - 1;
+    while(first <= last && !word.at(first).isLetterOrNumber())
+    {
+        first++;
+    }
+    while(last >= first && !word.at(last).isLetterOrNumber())
+    {
+        last--;
+    }
+    return word.mid(first, last - first + 1).toLower();
+}
+
+bool
+TextIndex::occursBefore(
+        Occurrence const &a,
+        Occurrence const &b
+)
+{
+    return a.pageNumber < b.pageNumber || (a.pageNumber == b.pageNumber && a.position < b.position);
+}
+
+bool
+TextIndex::isBehind(
+        Cursor const &a,
+        Cursor const &b
+)
+{
+    return occursBefore(*b.current, *a.current);
+}
+
+void
+TextIndex::run()
+{
+    Poppler::Document * const document = Poppler::Document::load(mPath);
+    if(!document || document->isLocked())
+    {
+        delete document;
+        return;
+    }
+
+    for(int pageNumber = 0; pageNumber < mPageCount && 0 == static_cast<int>(mQuit); pageNumber++)
+    {
+        // Extract the text without holding the lock, as that takes by far the most time:
+        QVector<QString> words;
+        QVector<QRectF> boxes;
+        Poppler::Page * const page = document->page(pageNumber);
+        if(page)
+        {
+            QList<Poppler::TextBox *> const textBoxes = page->textList();
+            for(int i = 0; i < textBoxes.size(); i++)
+            {
+                QString const word = normalized(textBoxes.at(i)->text());
+                if(!word.isEmpty())
+                {
+                    words.append(word);
+                    boxes.append(textBoxes.at(i)->boundingBox());
+                }
+            }
+            qDeleteAll(textBoxes);
+            delete page;
+        }
+
+        {
+            QWriteLocker locker(&mLock);
+            for(int position = 0; position < words.size(); position++)
+            {
+                Occurrence const occurrence = { pageNumber, position };
+                mIndex[words.at(position)].append(occurrence);
+            }
+            mPageWords[pageNumber] = words;
+            mPageBoxes[pageNumber] = boxes;
+            mIndexedPageCount = pageNumber + 1;
+        }
+
+        if(0 == (pageNumber + 1) % PROGRESS_INTERVAL || pageNumber + 1 == mPageCount)
+        {
+            emit progressed();
+        }
+    }
+
+    delete document;
+}
+
+QList<TextIndex::Hit>
+TextIndex::search(
+        QString const &text,
+        int const maxHits
+) const
+{
+    QStringList query = text.simplified().split(' ', QString::SkipEmptyParts);
+    for(int i = query.size() - 1; i >= 0; i--)
+    {
+        query[i] = normalized(query.at(i));
+        if(query.at(i).isEmpty())
+        {
+            query.removeAt(i);
+        }
+    }
+    if(query.isEmpty())
+    {
+        return QList<Hit>();
+    }
+
+    QReadLocker locker(&mLock);
+
+    // Candidates are the occurrences of the first word, which also matches as prefix if it is the only one.
+    // The occurrences of every word are appended in document order while indexing, so they are sorted already.
+    // Those of all matching words are merged lazily through a heap, so merging stops once enough hits have been found.
+    // The occurrences are pointed to directly, as the index does not change while locked for reading:
+    QVector<Cursor> cursors;
+    bool const prefix = 1 == query.size();
+    for(QMap<QString, QVector<Occurrence> >::const_iterator entry = mIndex.lowerBound(query.first());
+        entry != mIndex.constEnd() && (prefix ? entry.key().startsWith(query.first()) : entry.key() == query.first());
+        ++entry)
+    {
+        if(!entry.value().isEmpty())
+        {
+            Cursor const cursor = { entry.value().constData(), entry.value().constData() + entry.value().size() };
+            cursors.append(cursor);
+        }
+    }
+    std::make_heap(cursors.begin(), cursors.end(), isBehind);
+
+    // The following words of the query have to follow in succession, the last one again as prefix:
+    QList<Hit> hits;
+    while(!cursors.isEmpty() && hits.size() < maxHits)
+    {
+        // The earliest occurrence of all words is taken from the front of the heap:
+        std::pop_heap(cursors.begin(), cursors.end(), isBehind);
+        Cursor &cursor = cursors.last();
+        int const pageNumber = cursor.current->pageNumber;
+        int const position = cursor.current->position;
+        if(++cursor.current == cursor.end)
+        {
+            cursors.remove(cursors.size() - 1);
+        }
+        else
+        {
+            std::push_heap(cursors.begin(), cursors.end(), isBehind);
+        }
+
+        QVector<QString> const &words = mPageWords.at(pageNumber);
+        if(position + query.size() > words.size())
+        {
+            continue;
+        }
+
+        bool matches = true;
+        for(int j = 1; matches && j < query.size(); j++)
+        {
+            QString const &word = words.at(position + j);
+            matches = j + 1 < query.size() ? word == query.at(j) : word.startsWith(query.at(j));
+        }
+        if(!matches)
+        {
+            continue;
+        }
+
+        Hit hit;
+        hit.pageNumber = pageNumber;
+        for(int j = 0; j < query.size(); j++)
+        {
+            hit.boxes.append(mPageBoxes.at(pageNumber).at(position + j));
+        }
+        hits.append(hit);
+    }
+    return hits;
+}
+
+} // namespace pdf_viewer
@@ -0,0 +1,113 @@
+#ifndef TEXTINDEX_H
+#define TEXTINDEX_H
+
+#include <QThread>
+#include <QAtomicInt>
+#include <QList>
+#include <QMap>
+#include <QReadWriteLock>
+#include <QRectF>
+#include <QString>
+#include <QVector>
+
+namespace pdf_viewer {
+
+/*!
+ * \class TextIndex
+ * \brief Inverted index over the words of a document, built page by page within a background thread.
+ *
+ * The thread extracts the text of one page after the other through its own Poppler document and adds
+ * its words to the index right away, so searching works while extraction is still in progress, just
+ * with hits on the pages indexed so far. Words are compared case-insensitively, ignoring punctuation
+ * around them. As the index is sorted, the last word of a query also matches as prefix, so results
+ * are available while the user is still typing.
+ */
+class TextIndex : public QThread
+{
+
+    Q_OBJECT
+
+public:
+
+    /*!
+     * \brief A single occurrence of a searched text.
+     */
+    struct Hit
+    {
+        int pageNumber;         //!< Zero based page number
+        QList<QRectF> boxes;    //!< Bounding boxes of the matched words, in points of the upright page
+    };
+
+    /*!
+     * \brief Construct the index, which starts indexing as soon as the thread is started.
+     * \param path Document file path.
+     * \param pageCount Number of pages to index.
+     */
+    TextIndex(QString const &path, int const pageCount, QObject * const parent);
+
+    virtual ~TextIndex();
+
+    /*!
+     * \brief Asks the thread to stop after the page being indexed right now.
+     */
+    void cancel();
+
+    /*!
+     * \brief Number of pages indexed so far.
+     */
+    int indexedPageCount() const;
+
+    /*!
+     * \brief Looks up a text within the pages indexed so far.
+     * \param text One or more words, which have to appear in succession.
+     * \param maxHits Maximum number of hits returned.
+     * \return Hits ordered by their position within the document.
+     */
+    QList<Hit> search(QString const &text, int const maxHits) const;
+
+signals:
+
+    /*!
+     * \brief Emitted from within the indexing thread whenever some more pages have been indexed.
+     */
+    void progressed();
+
+protected:
+
+    virtual void run();
+
+private:
+
+    // Position of a word within the document:
+    struct Occurrence
+    {
+        int pageNumber;
+        int position;
+    };
+
+    // Next occurrence within the occurrences of a single word, which are in document order:
+    struct Cursor
+    {
+        Occurrence const *current;
+        Occurrence const *end;
+    };
+
+    static QString normalized(QString const &word);
+    static bool occursBefore(Occurrence const &a, Occurrence const &b);
+    static bool isBehind(Cursor const &a, Cursor const &b);
+
+    QString const mPath;
+    int const mPageCount;
+    QAtomicInt mQuit;
+
+    mutable QReadWriteLock mLock;
+    QMap<QString, QVector<Occurrence> > mIndex;
+    QVector<QVector<QString> > mPageWords;
+    QVector<QVector<QRectF> > mPageBoxes;
+    int mIndexedPageCount;
+
+};
+
+} // namespace pdf_viewer
+
+#endif // TEXTINDEX_H
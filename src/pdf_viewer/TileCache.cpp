@@ -0,0 +1,132 @@
+#include "TileCache.h"
+
+#include <qmath.h>
+
+namespace pdf_viewer {
+
+const int TileCache::TILE_SIZE = 256;
+const int TileKey::WHOLE_PAGE = -1;
+const int TileKey::THUMBNAIL = -2;
+
+TileKey::TileKey()
+    : pageNumber(-1)
+    , scale(0)
+    , orientation(0)
+    , renderHints(0)
+    , column(0)
+    , row(0)
+{
+}
+
+TileKey::TileKey(
+        int const pageNumber,
+        qreal const scale,
+        int const orientation,
+        int const renderHints,
+        int const column,
+        int const row
+)
+    : pageNumber(pageNumber)
+    , scale(qRound(scale * 1000))
+    , orientation(orientation)
+    , renderHints(renderHints)
+    , column(column)
+    , row(row)
+{
+}
+
+TileKey
+TileKey::wholePage(
+        int const pageNumber,
+        qreal const scale,
+        int const orientation,
+        int const renderHints
+)
+{
+    return TileKey(pageNumber, scale, orientation, renderHints, WHOLE_PAGE, WHOLE_PAGE);
+}
+
+TileKey
+TileKey::thumbnail(
+        int const pageNumber,
+        qreal const scale
+)
+{
+    return TileKey(pageNumber, scale, 0, TEXT_ANTI_ALIASED | IMAGE_ANTI_ALIASED, THUMBNAIL, THUMBNAIL);
+}
+
+bool
+TileKey::operator==(
+        TileKey const &other
+) const
+{
+    return pageNumber == other.pageNumber
+            && scale == other.scale
+            && orientation == other.orientation
+            && renderHints == other.renderHints
+            && column == other.column
+            && row == other.row;
+}
+
+uint
+qHash(
+        TileKey const &key
+)
+{
+    return (static_cast<uint>(key.pageNumber) * 31 + static_cast<uint>(key.scale)) * 4
+            + static_cast<uint>(key.orientation)
+            + (static_cast<uint>(key.renderHints) << 8)
+            + (static_cast<uint>(key.column) << 16)
+            + (static_cast<uint>(key.row) << 24);
+}
+
+TileCache::TileCache(
+        int const budget
+)
+    : mTiles(budget)
+{
+}
+
+void
+TileCache::setBudget(
+        int const budget
+)
+{
+    mTiles.setMaxCost(budget);
+}
+
+QImage
+TileCache::tile(
+        TileKey const &key
+) const
+{
+    QImage const * const image = mTiles.object(key);
+    return image ? *image : QImage();
+}
+
+void
+TileCache::insert(
+        TileKey const &key,
+        QImage const &image
+)
+{
+    mTiles.insert(key, new QImage(image), image.byteCount());
+}
+
+void
+TileCache::clear()
+{
+    mTiles.clear();
+}
+
+QRect
+TileCache::tileRect(
+        int const column,
+        int const row,
+        QRect const &pageRect
+)
+{
+    return QRect(column * TILE_SIZE, row * TILE_SIZE, TILE_SIZE, TILE_SIZE) & pageRect;
+}
+
+} // namespace pdf_viewer
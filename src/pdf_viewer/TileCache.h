@@ -0,0 +1,110 @@
+#ifndef TILECACHE_H
+#define TILECACHE_H
+
+#include <QCache>
+#include <QImage>
+#include <QRect>
+
+namespace pdf_viewer {
+
+/*!
+ * \struct TileKey
+ * \brief Identifies a single rendered tile of a page.
+ * Tiles form a regular grid over the scaled page, starting at its top left corner.
+ * The scale is stored in thousandths, which is the same precision the viewer compares scales at.
+ * An image of the whole page is stored under the column and row WHOLE_PAGE, a page thumbnail under THUMBNAIL.
+ * As tiles are shared between viewers, the render hints they have been rasterized with are part of the key.
+ */
+struct TileKey
+{
+    /*!
+     * \brief Anti-aliasing flags a tile has been rendered with.
+     */
+    enum RenderHint {
+        TEXT_ANTI_ALIASED = 0x1,
+        IMAGE_ANTI_ALIASED = 0x2
+    };
+
+    TileKey();
+    TileKey(int const pageNumber, qreal const scale, int const orientation, int const renderHints, int const column, int const row);
+
+    /*!
+     * \brief Key of an image covering the whole page.
+     */
+    static TileKey wholePage(int const pageNumber, qreal const scale, int const orientation, int const renderHints);
+
+    /*!
+     * \brief Key of a page thumbnail, which is always rendered upright and anti-aliased.
+     */
+    static TileKey thumbnail(int const pageNumber, qreal const scale);
+
+    bool operator==(TileKey const &other) const;
+
+    static const int WHOLE_PAGE;
+    static const int THUMBNAIL;
+
+    int pageNumber;             //!< Zero based page number
+    int scale;                  //!< Scale relative to 72 DPI, multiplied by 1000
+    int orientation;            //!< Page orientation, numerically equal to Poppler::Page::Rotation
+    int renderHints;            //!< Combination of RenderHint flags
+    int column;                 //!< Horizontal tile index
+    int row;                    //!< Vertical tile index
+};
+
+uint qHash(TileKey const &key);
+
+/*!
+ * \class TileCache
+ * \brief Least recently used cache of rendered page tiles, bounded by a memory budget in bytes.
+ */
+class TileCache
+{
+
+public:
+
+    /*!
+     * \brief Edge length of a tile in pixels.
+     */
+    static const int TILE_SIZE;
+
+    /*!
+     * \brief Construct an empty cache.
+     * \param budget Maximum amount of bytes occupied by the cached images.
+     */
+    TileCache(int const budget);
+
+    void setBudget(int const budget);
+
+    /*!
+     * \brief Looks up a tile and marks it as recently used.
+     * \return The tile image, or a null image if the tile has not been cached.
+     */
+    QImage tile(TileKey const &key) const;
+
+    /*!
+     * \brief Caches a tile, evicting least recently used tiles if the budget is exceeded.
+     */
+    void insert(TileKey const &key, QImage const &image);
+
+    /*!
+     * \brief Removes all tiles.
+     */
+    void clear();
+
+    /*!
+     * \brief The area of a tile in scaled page space, clipped to the page.
+     * \param column Horizontal tile index.
+     * \param row Vertical tile index.
+     * \param pageRect Scaled page rect, with its origin at zero.
+     */
+    static QRect tileRect(int const column, int const row, QRect const &pageRect);
+
+private:
+
+    QCache<TileKey, QImage> mTiles;
+
+};
+
+} // namespace pdf_viewer
+
+#endif // TILECACHE_H
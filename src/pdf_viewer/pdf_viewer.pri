@@ -0,0 +1,38 @@
+# PDF viewer component, shared by the application and the benchmark:
+LIBS += -lpoppler-qt4
+
+INCLUDEPATH += $$PWD/..
+
+SOURCES += \
+    $$PWD/PdfViewer.cpp \
+    $$PWD/PdfDocument.cpp \
+    $$PWD/PdfThumbnail.cpp \
+    $$PWD/PdfThumbnails.cpp \
+    $$PWD/DiskCache.cpp \
+    $$PWD/DocumentRegistry.cpp \
+    $$PWD/Framebuffer.cpp \
+    $$PWD/KineticAnimation.cpp \
+    $$PWD/SharedDocument.cpp \
+    $$PWD/SlideAnimation.cpp \
+    $$PWD/Polynomial.cpp \
+    $$PWD/RenderPool.cpp \
+    $$PWD/RenderStats.cpp \
+    $$PWD/TextIndex.cpp \
+    $$PWD/TileCache.cpp
+
+HEADERS += \
+    $$PWD/PdfViewer.h \
+    $$PWD/PdfDocument.h \
+    $$PWD/PdfThumbnail.h \
+    $$PWD/PdfThumbnails.h \
+    $$PWD/DiskCache.h \
+    $$PWD/DocumentRegistry.h \
+    $$PWD/Framebuffer.h \
+    $$PWD/KineticAnimation.h \
+    $$PWD/SharedDocument.h \
+    $$PWD/SlideAnimation.h \
+    $$PWD/Polynomial.h \
+    $$PWD/RenderPool.h \
+    $$PWD/RenderStats.h \
+    $$PWD/TextIndex.h \
+    $$PWD/TileCache.h